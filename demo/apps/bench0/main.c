@@ -0,0 +1,154 @@
+/// @file   main.c
+/// @brief  RISC-V Test Monitor - VS-mode guest world switch benchmark #0.
+///         HS-mode context switch between 2, 4 and 8 guests, VS-mode CSRs,
+///         L1/L2 MPU state, only differing state is rewritten.
+
+
+#include "arch.h"
+#include "mtvec.h"
+#include "stvec.h"
+#include "tmon.h"
+#include "cntr.h"
+#include "smpu.h"
+#include "vctx.h"
+#include "alloc.h"
+#include "mpool.h"
+
+// Exports from linker script
+extern volatile long __htif_base[], __htif_size;
+extern volatile long __mmio_base[], __mmio_size;
+extern long __data_base, __data_size;
+extern long __rodata_base, __rodata_size;
+extern long __text_base, __text_size;
+
+
+#define GUESTS_MAX      8
+#define ROUNDS          16      // world switches per guest
+
+
+/* Shared L2 (HS-mode) regions, the same for all guests */
+
+static const unsigned long L2_SHARED[][2] = {
+        { (long)&__text_base   + 0, (long)&__text_size   + HMPU_ATTR_SRX },  // [0]
+        { (long)&__rodata_base + 0, (long)&__rodata_size + HMPU_ATTR_SRO },  // [1]
+        { (long)&__mmio_base   + 0, (long)&__mmio_size   + HMPU_ATTR_SRW },  // [2]
+        { (long)&__htif_base   + 0, (long)&__htif_size   + HMPU_ATTR_SRW },  // [3]
+};
+
+static vctx_t guest[GUESTS_MAX];
+static vctx_t host;
+
+
+/// @name  guest_setup( *ctx, id, size )
+/// @brief guest context with shared L2 regions and private data/heap window,
+///        window is one protection-aligned heap block (one L2 and one L1 region)
+static int guest_setup(vctx_t *ctx, int id, unsigned long size) {
+
+        unsigned long  l2[2][2];
+        mpool_region_t win, l1;
+
+        if ( 0 == mpool_alloc_region(&heap_arena, MPOOL_SMPU, size, HMPU_ATTR_SRW, &win) )
+                return -1;
+
+        vctx_init(ctx, 0);
+
+        ctx->csr[2] = (unsigned long)&__text_base;      // vstvec 
+        ctx->csr[3] = 0x1000 + id;                      // vsscratch
+        ctx->csr[4] = (unsigned long)&__text_base;      // vsepc
+
+        l2[0][0] = (unsigned long)&__data_base;
+        l2[0][1] = (unsigned long)&__data_size + HMPU_ATTR_SRW;
+        l2[1][0] = win.entry[0];                        // private heap window
+        l2[1][1] = win.entry[1];
+
+        vctx_l2_config(ctx, 0, 4, L2_SHARED, 0);
+        vctx_l2_config(ctx, 4, 2, l2, 0x3F);
+
+        mpool_region(MPOOL_SMPU, (void *)win.base, win.size, SMPU_ATTR_SRW, &l1);
+
+        ctx->l1[0][0] = l1.entry[0];                    // guest L1: private window only
+        ctx->l1[0][1] = l1.entry[1];
+        ctx->l1_mask  = 0x01;
+
+        return 0;
+}
+
+
+/// @name  bench( num )
+/// @brief round-robin world switches between `num` guests
+static void bench(int num) {
+
+        cntr_scope_t sc = CNTR_SCOPE_INIT("switch");
+        unsigned long writes = 0, full = 0;
+        int cur = 0, next;
+        ret_t ret;
+
+        vctx_load(&guest[0]);
+
+        for (int i = 0; i < ROUNDS * num; i++) {
+                next = (cur + 1) % num;
+                CNTR_SCOPE(&sc) {
+                        ret = vctx_switch(&guest[cur], &guest[next]);
+                }
+                writes += ret.a1;
+                cur = next;
+        }
+
+        /* reference: full reload of guest context */
+
+        for (int i = 0; i < num; i++) {
+                ret = vctx_load(&guest[i]);
+                full += ret.a1;
+        }
+
+        printf("  %d guests: %ld/%ld cycles/switch (avg/max), %ld instret/switch, %ld/%ld register writes/switch (delta/full)\n", 
+                num, (unsigned long)(sc.cycles / sc.num), sc.max, (unsigned long)(sc.instrets / sc.num),
+                writes / (ROUNDS * num), full / num);
+}
+
+
+int main(void)
+{
+
+        unsigned long size;
+
+        printf("%s: VS-mode guest world switch benchmark\n", __func__);
+
+        /* M-mode setup, cycle and instret counters are readable in S-mode */
+
+        m_trap_mode(TRAP_MODE_DIRECT);
+
+        cntr_m_enable(CNTR_CY | CNTR_IR, 0);
+
+        tmon_call(TMON_FID_PRIV, S_MODE);      // to S
+
+        s_trap_mode(TRAP_MODE_DIRECT);
+
+        /* guest heap windows, worst case alignment padding is reserved */
+
+        heap_init();
+
+        size = ((arena_free(&heap_arena) - MPOOL_SMPU_GRAIN) / GUESTS_MAX) & ~(MPOOL_SMPU_GRAIN - 1);
+
+        for (int i = 0; i < GUESTS_MAX; i++) {
+                if ( guest_setup(&guest[i], i, size) ) {
+                        ERROR("guest %d heap window allocation failed\n", i);
+                        exit(1);
+                }
+        }
+
+    CASE(1);
+
+        bench(2);
+        bench(4);
+        bench(8);
+
+        /* restore host state: VS-mode CSRs cleared, L1/L2 MPU disabled */
+
+        vctx_init(&host, 0);
+        vctx_load(&host);
+
+        tmon_call(TMON_FID_PRIV, M_MODE);       // to M
+
+        exit(0);
+}
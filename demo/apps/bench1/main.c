@@ -0,0 +1,177 @@
+/// @file   main.c
+/// @brief  RISC-V Test Monitor - guest external interrupt latency benchmark #1.
+///         VS-mode external interrupt delivered directly by IMSIC guest
+///         interrupt file (hstatus.VGEIN) vs software injection by HS-mode
+///         (S-level interrupt file -> HS-mode handler -> hvip.VSEIP).
+
+
+#include "arch.h"
+#include "mtvec.h"
+#include "stvec.h"
+#include "vtvec.h"
+#include "tmon.h"
+#include "cntr.h"
+#include "imsic.h"
+
+
+#define GFILE           1       // guest interrupt file of VS partition
+#define GUEST_EIID      5       // guest file interrupt identity
+#define HOST_EIID       6       // S-level file interrupt identity, injected to guest
+#define ROUNDS          32
+
+
+typedef struct lat_s {
+        unsigned long min;
+        unsigned long max;
+        unsigned long sum;
+} lat_t;
+
+static volatile unsigned long t_send, t_entry, done;
+
+
+/// @name  guest_direct( *s )
+/// @brief VS-mode handler of guest file interrupt (claimed by vstopei)
+static void guest_direct(void *s) {
+
+        __csrr(t_entry, CSR_CYCLE);
+
+        done = 1;
+}
+
+
+/// @name  guest_soft( *s )
+/// @brief VS-mode external interrupt handler, interrupt is injected by
+///        HS-mode with hvip.VSEIP and de-asserted with TMON_FID_GMSI
+static void guest_soft(void *s) {
+
+        __csrr(t_entry, CSR_CYCLE);
+
+        tmon_call(TMON_FID_GMSI, TMON_GMSI(0, 0));
+
+        done = 1;
+}
+
+
+/// @name  host_inject( *s )
+/// @brief HS-mode handler of S-level file interrupt, forwards it to the
+///        running guest (software injection)
+static void host_inject(void *s) {
+
+        __csrs(CSR_HVIP, HIP_VSEIP);
+}
+
+
+/// @name  bench( *name, fid, arg, *lat )
+/// @brief send interrupt with tmon_call(fid, arg) from VS-mode and measure
+///        cycles until VS-mode handler entry
+static void bench(const char *name, unsigned long fid, unsigned long arg, lat_t *lat) {
+
+        unsigned long delta;
+
+        lat->min = ~0UL;
+        lat->max = 0;
+        lat->sum = 0;
+
+        for (int i = 0; i < ROUNDS; i++) {
+
+                done = 0;
+
+                __csrr(t_send, CSR_CYCLE);
+
+                tmon_call(fid, arg);
+
+                while (!done)
+                        ;
+
+                delta = t_entry - t_send;
+
+                lat->sum += delta;
+                if (delta < lat->min) lat->min = delta;
+                if (delta > lat->max) lat->max = delta;
+        }
+
+        printf("  %s: %ld/%ld/%ld cycles (min/avg/max)\n", name, lat->min, lat->sum / ROUNDS, lat->max);
+}
+
+
+int main(void)
+{
+        lat_t direct, soft;
+        long gfiles;
+
+        printf("%s: guest external interrupt latency benchmark\n", __func__);
+
+        /* M-mode setup */
+
+        m_trap_mode(TRAP_MODE_DIRECT);
+        m_exc_delegate(TRAP_EID_UCALL, 1);
+        m_exc_delegate(TRAP_EID_VCALL, 1);          // VS-mode ecalls are served by HS-mode monitor
+        m_maj_delegate(CSR_MIDELEG_SEI_BIT, 1);     // S-level interrupt file to HS-mode
+
+        cntr_m_enable(CNTR_CY, 0);
+
+        tmon_call(TMON_FID_PRIV, S_MODE);           // to HS
+
+        /* HS-mode setup */
+
+        s_trap_mode(TRAP_MODE_DIRECT);
+        s_maj_delegate(CSR_HIDELEG_VSEI_BIT, 1);    // VS external interrupts to VS-mode
+
+        cntr_h_enable(CNTR_CY);
+
+        s_ext_setvec(HOST_EIID, host_inject);
+        s_ext_delivery(1);
+        s_ext_threshold(0);
+        s_ext_enable(HOST_EIID, 1);
+        s_maj_enable(CSR_MIE_SEIE_BIT, 1);
+
+        gfiles = imsic_guest_num().a0;
+
+        printf("  %ld IMSIC guest interrupt files\n", gfiles);
+
+        if (gfiles) {
+                imsic_guest_delivery(GFILE, 1);
+                imsic_guest_threshold(GFILE, 0);
+                imsic_guest_enable(GFILE, GUEST_EIID, 1);
+                imsic_guest_assign(GFILE);
+        }
+
+        tmon_call(TMON_FID_PRIV, VS_MODE);          // to VS
+
+        v_trap_mode(TRAP_MODE_DIRECT);
+        v_ext_setvec(GUEST_EIID, guest_direct);
+        v_maj_enable(CSR_MIE_SEIE_BIT, 1);
+        v_all_enable(1);
+
+    CASE(1);    /* direct delivery, guest interrupt file */
+
+        if (gfiles)
+                bench("guest file   ", TMON_FID_GMSI, TMON_GMSI(GFILE, GUEST_EIID), &direct);
+        else
+                WARNING("no IMSIC guest interrupt files, direct delivery is skipped\n");
+
+    CASE(2);    /* software injection, no guest interrupt file */
+
+        v_all_enable(0);
+
+        tmon_call(TMON_FID_PRIV, S_MODE);           // to HS
+
+        imsic_guest_assign(0);
+
+        tmon_call(TMON_FID_PRIV, VS_MODE);          // to VS
+
+        v_maj_setvec(CSR_MIE_SEIE_BIT, guest_soft);
+        v_all_enable(1);
+
+        bench("hvip.VSEIP   ", TMON_FID_SMSI, HOST_EIID, &soft);
+
+        if (gfiles)
+                printf("  direct delivery: %ld cycles/interrupt less (avg)\n",
+                        (long)(soft.sum / ROUNDS) - (long)(direct.sum / ROUNDS));
+
+        v_all_enable(0);
+
+        tmon_call(TMON_FID_PRIV, M_MODE);           // to M
+
+        exit(0);
+}
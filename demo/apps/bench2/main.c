@@ -0,0 +1,177 @@
+/// @file   main.c
+/// @brief  RISC-V Test Monitor - APLIC wired-source burst throughput benchmark #2.
+///         Bursts of edge-sensitive sources are set pending in APLIC and
+///         forwarded as MSIs to M-level and S-level IMSIC files, the full
+///         source-to-handler path is compared with direct IMSIC MMIO writes.
+
+
+#include "arch.h"
+#include "mtvec.h"
+#include "stvec.h"
+#include "tmon.h"
+#include "cntr.h"
+#include "aplic.h"
+#include "imsic.h"
+
+
+#define NSRC            16      // sources in burst, source n -> EIID n
+#define BURSTS          8
+#define TIMEOUT         100000  // wait loop iterations for handled interrupts
+
+
+static volatile unsigned long handled;
+
+
+/// @name  count( *s )
+/// @brief M/S-mode external interrupt handler (claimed by wrapper)
+static void count(void *s) {
+
+        handled++;
+}
+
+
+/// @name  wait_handled( expect )
+/// @brief wait until expected number of interrupts is handled (or timeout)
+static void wait_handled(unsigned long expect) {
+
+        unsigned long timeout = TIMEOUT;
+
+        while ((handled < expect) && --timeout)
+                ;
+}
+
+
+/// @name  report( *name, start, expect, mcycle )
+/// @brief print throughput, not handled interrupts are reported as drops
+static void report(const char *name, unsigned long start, unsigned long expect, int mcycle) {
+
+        unsigned long stop;
+
+        if (mcycle)
+                __csrr(stop, CSR_MCYCLE);
+        else
+                __csrr(stop, CSR_CYCLE);
+
+        stop -= start;
+
+        printf("  %s: %ld/%ld handled, %ld drops, %ld cycles/interrupt, %ld interrupts/Mcycle\n",
+                name, handled, expect, expect - handled, stop / (handled ? handled : 1),
+                (handled * 1000000) / (stop ? stop : 1));
+}
+
+
+int main(void)
+{
+        unsigned long start;
+        tmon_aplic_t req;
+
+        printf("%s: APLIC wired-source burst throughput benchmark\n", __func__);
+
+        /* M-mode setup, sources 1..NSRC of M-domain -> M-level EIIDs 1..NSRC */
+
+        m_trap_mode(TRAP_MODE_DIRECT);
+        m_maj_delegate(TRAP_IID_SEXT, 1);           // S-level IMSIC file to S-mode
+
+        cntr_m_enable(CNTR_CY, 0);
+
+        aplic_init();
+
+        for (int src = 1; src <= NSRC; src++) {
+                aplic_source(APLIC_M_DOMAIN, src, EDGE1);
+                aplic_target(APLIC_M_DOMAIN, src, src);
+                m_ext_setvec(src, count);
+        }
+
+        m_ext_delivery(1);
+        m_ext_threshold(0);
+        imsic_ext_enable_range(IMSIC_LEVEL_M, 1, NSRC, 1);
+        m_maj_enable(TRAP_IID_MEXT, 1);
+        m_all_enable(1);
+
+    CASE(1);    /* M-domain wired-source bursts, setipnum -> MSI -> M-level file */
+
+        handled = 0;
+
+        __csrr(start, CSR_MCYCLE);
+
+        for (int i = 0; i < BURSTS; i++) {
+                aplic_setip(APLIC_M_DOMAIN, 1, NSRC);
+                wait_handled((i + 1) * NSRC);
+        }
+
+        report("M-domain burst  ", start, BURSTS * NSRC, 1);
+
+    CASE(2);    /* reference: direct MSI writes to M-level file */
+
+        handled = 0;
+
+        __csrr(start, CSR_MCYCLE);
+
+        for (int i = 0; i < BURSTS; i++) {
+                for (int eiid = 1; eiid <= NSRC; eiid++)
+                        __mmsi_base[0] = eiid;
+                wait_handled((i + 1) * NSRC);
+        }
+
+        report("M-level MSI     ", start, BURSTS * NSRC, 1);
+
+        m_all_enable(0);
+
+        /* S-mode setup, sources of S-domain (delegated by M-domain)
+           are configured with TMON_FID_APLIC requests */
+
+        tmon_call(TMON_FID_PRIV, S_MODE);           // to S
+
+        s_trap_mode(TRAP_MODE_DIRECT);
+
+        for (int src = 1; src <= NSRC; src++) {
+                req = (tmon_aplic_t){ TMON_APLIC_SOURCE, APLIC_S_DOMAIN, src, EDGE1 };
+                tmon_call(TMON_FID_APLIC, &req);
+                req = (tmon_aplic_t){ TMON_APLIC_TARGET, APLIC_S_DOMAIN, src, src };
+                tmon_call(TMON_FID_APLIC, &req);
+                s_ext_setvec(src, count);
+        }
+
+        s_ext_delivery(1);
+        s_ext_threshold(0);
+        imsic_ext_enable_range(IMSIC_LEVEL_S, 1, NSRC, 1);
+        s_maj_enable(TRAP_IID_SEXT, 1);
+        s_all_enable(1);
+
+    CASE(3);    /* S-domain wired-source bursts, one monitor call per burst */
+
+        handled = 0;
+
+        req = (tmon_aplic_t){ TMON_APLIC_SETIP, APLIC_S_DOMAIN, 1, NSRC };
+
+        __csrr(start, CSR_CYCLE);
+
+        for (int i = 0; i < BURSTS; i++) {
+                tmon_call(TMON_FID_APLIC, &req);
+                wait_handled((i + 1) * NSRC);
+        }
+
+        report("S-domain burst  ", start, BURSTS * NSRC, 0);
+
+    CASE(4);    /* S-domain genmsi, one monitor call per interrupt */
+
+        handled = 0;
+
+        __csrr(start, CSR_CYCLE);
+
+        for (int i = 0; i < BURSTS; i++) {
+                for (int eiid = 1; eiid <= NSRC; eiid++) {
+                        req = (tmon_aplic_t){ TMON_APLIC_GENMSI, APLIC_S_DOMAIN, eiid, 0 };
+                        tmon_call(TMON_FID_APLIC, &req);
+                }
+                wait_handled((i + 1) * NSRC);
+        }
+
+        report("S-domain genmsi ", start, BURSTS * NSRC, 0);
+
+        s_all_enable(0);
+
+        tmon_call(TMON_FID_PRIV, M_MODE);           // to M
+
+        exit(0);
+}
@@ -0,0 +1,193 @@
+/// @file   main.c
+/// @brief  RISC-V Test Monitor - interrupt storm throughput benchmark #3.
+///         M-level and S-level IMSIC files are flooded with bursts of MSIs
+///         (TMON_FID_BMSI, one monitor call per burst) in each trap mode,
+///         handled interrupts per Mcycle, drops and maximum pending depth
+///         are reported.
+
+
+#include "arch.h"
+#include "mtvec.h"
+#include "stvec.h"
+#include "tmon.h"
+#include "cntr.h"
+#include "imsic.h"
+
+
+#define NEIID           31      // EIIDs 1..31 in burst (eip0)
+#define BURSTS          16
+#define TIMEOUT         100000  // wait loop iterations for handled interrupts
+
+
+static volatile unsigned long handled, depth_max;
+static int level;               // IMSIC_LEVEL_M, IMSIC_LEVEL_S of flooded file
+
+static unsigned long flood[2 * NEIID];
+
+
+/// @name  count( *s )
+/// @brief M/S-mode external interrupt handler (claimed by wrapper), pending
+///        depth is the number of pending EIIDs including the claimed one
+static void count(void *s) {
+
+        unsigned long map, depth;
+
+        imsic_ext_pending_map(level, 0, 1, &map);
+
+        for (depth = 1; map; map &= map - 1)
+                depth++;
+
+        if (depth > depth_max)
+                depth_max = depth;
+
+        handled++;
+}
+
+
+/// @name  wait_handled( expect )
+/// @brief wait until expected number of interrupts is handled (or timeout)
+static void wait_handled(unsigned long expect) {
+
+        unsigned long timeout = TIMEOUT;
+
+        while ((handled < expect) && --timeout)
+                ;
+}
+
+
+/// @name  storm( *name, *req, mcycle )
+/// @brief send BURSTS bursts back-to-back and print throughput, MSIs sent
+///        but not handled (coalesced in pending bits) are reported as drops
+static void storm(const char *name, tmon_bmsi_t *req, int mcycle) {
+
+        unsigned long start, stop, sent = 0;
+
+        handled   = 0;
+        depth_max = 0;
+
+        if (mcycle)
+                __csrr(start, CSR_MCYCLE);
+        else
+                __csrr(start, CSR_CYCLE);
+
+        for (int i = 0; i < BURSTS; i++) {
+                tmon_call(TMON_FID_BMSI, req);
+                sent += req->num;
+        }
+
+        wait_handled(sent);
+
+        if (mcycle)
+                __csrr(stop, CSR_MCYCLE);
+        else
+                __csrr(stop, CSR_CYCLE);
+
+        stop -= start;
+
+        printf("  %s: %ld/%ld handled, %ld drops, %ld max depth, %ld interrupts/Mcycle\n",
+                name, handled, sent, sent - handled, depth_max,
+                (handled * 1000000) / (stop ? stop : 1));
+}
+
+
+/// @name  m_flood( *name, mode, *req )
+/// @brief M-level file storm in trap mode (skipped if mode is not supported)
+static void m_flood(const char *name, int mode, tmon_bmsi_t *req) {
+
+        if (m_trap_mode(mode)) {
+                printf("  %s: trap mode %d is not supported, skipped\n", name, mode);
+                return;
+        }
+
+        for (int eiid = 1; eiid <= NEIID; eiid++)
+                m_ext_setvec(eiid, count);
+
+        m_all_enable(1);
+        storm(name, req, 1);
+        m_all_enable(0);
+}
+
+
+/// @name  s_flood( *name, mode, *req )
+/// @brief S-level file storm in trap mode (skipped if mode is not supported)
+static void s_flood(const char *name, int mode, tmon_bmsi_t *req) {
+
+        if (s_trap_mode(mode) || s_ext_setvec(1, count)) {
+                printf("  %s: trap mode %d is not supported, skipped\n", name, mode);
+                s_trap_mode(TRAP_MODE_DIRECT);
+                return;
+        }
+
+        for (int eiid = 2; eiid <= NEIID; eiid++)
+                s_ext_setvec(eiid, count);
+
+        s_all_enable(1);
+        storm(name, req, 0);
+        s_all_enable(0);
+}
+
+
+int main(void)
+{
+        tmon_bmsi_t range, dup;
+
+        printf("%s: IMSIC interrupt storm throughput benchmark\n", __func__);
+
+        /* burst of NEIID distinct EIIDs and burst of duplicated EIIDs */
+
+        for (int i = 0; i < 2 * NEIID; i++)
+                flood[i] = 1 + (i % NEIID);
+
+        /* M-mode setup */
+
+        m_maj_delegate(TRAP_IID_SEXT, 1);           // S-level IMSIC file to S-mode
+
+        cntr_m_enable(CNTR_CY, 0);
+
+        m_ext_delivery(1);
+        m_ext_threshold(0);
+        imsic_ext_enable_range(IMSIC_LEVEL_M, 1, NEIID, 1);
+        m_maj_enable(TRAP_IID_MEXT, 1);
+
+        level = IMSIC_LEVEL_M;
+        range = (tmon_bmsi_t){ TMON_BMSI_M, NEIID, 1, 0 };
+        dup   = (tmon_bmsi_t){ TMON_BMSI_M, 2 * NEIID, 0, flood };
+
+    CASE(1);    /* M-level file, direct mode */
+
+        m_flood("M-level direct    ", TRAP_MODE_DIRECT, &range);
+        m_flood("M-level direct dup", TRAP_MODE_DIRECT, &dup);
+
+    CASE(2);    /* M-level file, nested vectored mode */
+
+        m_flood("M-level nested    ", TRAP_MODE_NESTED, &range);
+        m_flood("M-level nested dup", TRAP_MODE_NESTED, &dup);
+
+        m_maj_enable(TRAP_IID_MEXT, 0);
+
+        /* S-mode setup, bursts are served by S-mode monitor */
+
+        tmon_call(TMON_FID_PRIV, S_MODE);           // to S
+
+        s_ext_delivery(1);
+        s_ext_threshold(0);
+        imsic_ext_enable_range(IMSIC_LEVEL_S, 1, NEIID, 1);
+        s_maj_enable(TRAP_IID_SEXT, 1);
+
+        level = IMSIC_LEVEL_S;
+        range.level = TMON_BMSI_S;
+        dup.level   = TMON_BMSI_S;
+
+    CASE(3);    /* S-level file, direct mode */
+
+        s_flood("S-level direct    ", TRAP_MODE_DIRECT, &range);
+        s_flood("S-level direct dup", TRAP_MODE_DIRECT, &dup);
+
+    CASE(4);    /* S-level file, nested vectored mode */
+
+        s_flood("S-level nested    ", TRAP_MODE_NESTED, &range);
+
+        tmon_call(TMON_FID_PRIV, M_MODE);           // to M
+
+        exit(0);
+}
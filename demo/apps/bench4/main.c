@@ -0,0 +1,186 @@
+/// @file   main.c
+/// @brief  RISC-V Test Monitor - S-level self-IPI cost benchmark #4.
+///         S-mode software interrupt and S-level MSI are sent from S/U-mode
+///         with monitor request (ecall to M-mode) vs direct write of SSWI
+///         register and S-level IMSIC file mapped with SMPU (slib/sipi.c).
+
+
+#include "arch.h"
+#include "mtvec.h"
+#include "stvec.h"
+#include "tmon.h"
+#include "cntr.h"
+#include "smpu.h"
+#include "sipi.h"
+
+
+#define SMSI_EIID       3       // S-level file interrupt identity
+#define ROUNDS          32
+
+// Exports from linker script
+extern volatile long __htif_base[], __htif_size;
+extern long __data_base, __data_size;
+extern long __rodata_base, __rodata_size;
+extern long __text_base, __text_size;
+
+
+typedef void (*send_t)(void);
+
+typedef struct lat_s {
+        unsigned long min;
+        unsigned long max;
+        unsigned long sum;
+} lat_t;
+
+static volatile unsigned long t_send, t_entry, done;
+
+
+/* Shared S/U-mode memory map, MMIO is not mapped except SSWI page and
+   S-level IMSIC file (SMPU regions 5, 6 - sipi_smpu_map()) */
+
+static const unsigned long PTE[][2] = {
+        { (long)&__text_base    + 0, (long)&__text_size   + SMPU_ATTR_SXR  },  // [0]
+        { (long)&__rodata_base  + 0, (long)&__rodata_size + SMPU_ATTR_SRO  },  // [1]
+        { (long)&__data_base    + 0, (long)&__data_size   + SMPU_ATTR_SRW  },  // [2]
+        { (long)&__htif_base    + 0, (long)&__htif_size   + SMPU_ATTR_SRW  },  // [3]
+        { 0, 0 },                                                              // [4]
+};
+
+
+/// @name  sswi_entry( *s )
+/// @brief S-mode software interrupt handler, SSWI is de-asserted directly
+static void sswi_entry(void *s) {
+
+        __csrr(t_entry, CSR_CYCLE);
+
+        sipi_sswi(0);
+
+        done = 1;
+}
+
+
+/// @name  smsi_entry( *s )
+/// @brief S-level file interrupt handler (claimed by wrapper)
+static void smsi_entry(void *s) {
+
+        __csrr(t_entry, CSR_CYCLE);
+
+        done = 1;
+}
+
+
+/* send functions: monitor request vs direct write */
+
+static void call_sswi  (void) { tmon_call(TMON_FID_SSWI, 1); }
+static void direct_sswi(void) { sipi_sswi(1); }
+static void call_smsi  (void) { tmon_call(TMON_FID_SMSI, SMSI_EIID); }
+static void direct_smsi(void) { sipi_smsi(SMSI_EIID); }
+
+
+/// @name  bench( *name, send )
+/// @brief send self-interrupt and measure cycles until S-mode handler entry
+/// @return average cycles
+static unsigned long bench(const char *name, send_t send) {
+
+        lat_t lat = { ~0UL, 0, 0 };
+        unsigned long delta;
+
+        for (int i = 0; i < ROUNDS; i++) {
+
+                done = 0;
+
+                __csrr(t_send, CSR_CYCLE);
+
+                send();
+
+                while (!done)
+                        ;
+
+                delta = t_entry - t_send;
+
+                lat.sum += delta;
+                if (delta < lat.min) lat.min = delta;
+                if (delta > lat.max) lat.max = delta;
+        }
+
+        printf("  %s: %ld/%ld/%ld cycles (min/avg/max)\n", name, lat.min, lat.sum / ROUNDS, lat.max);
+
+        return lat.sum / ROUNDS;
+}
+
+
+/// @name  compare( *name, call, direct )
+/// @brief before/after: monitor request vs direct write
+static void compare(const char *name, send_t call, send_t direct) {
+
+        unsigned long before, after;
+
+        printf("  %s\n", name);
+
+        before = bench("  monitor request", call);
+        after  = bench("  direct write   ", direct);
+
+        printf("    direct write: %ld cycles/interrupt less (avg)\n", (long)before - (long)after);
+}
+
+
+int main(void)
+{
+        printf("%s: S-level self-IPI cost benchmark\n", __func__);
+
+        /* M-mode setup */
+
+        smpu_disable();                             // safe to pass control to S-mode
+
+        m_trap_mode(TRAP_MODE_DIRECT);
+        m_maj_delegate(TRAP_IID_SSWI, 1);
+        m_maj_delegate(TRAP_IID_SEXT, 1);
+
+        cntr_m_enable(CNTR_CY, 1);                  // cycle in S/U-mode
+
+        tmon_call(TMON_FID_PRIV, S_MODE);           // to S
+
+        /* S-mode setup */
+
+        s_trap_mode(TRAP_MODE_DIRECT);
+
+        smpu_group_config(0, 5, PTE);
+        smpu_group_enable(1, 0x0000000F);
+        sipi_smpu_map(5, 1);                        // SSWI and S-level file, shared S/U
+
+        s_maj_setvec(TRAP_IID_SSWI, sswi_entry);
+        s_maj_enable(TRAP_IID_SSWI, 1);
+
+        s_ext_setvec(SMSI_EIID, smsi_entry);
+        s_ext_delivery(1);
+        s_ext_threshold(0);
+        s_ext_enable(SMSI_EIID, 1);
+        s_maj_enable(TRAP_IID_SEXT, 1);
+
+        s_all_enable(1);
+
+    CASE(1);    /* S-mode self-IPI */
+
+        compare("S-mode SSWI", call_sswi, direct_sswi);
+
+    CASE(2);    /* S-mode MSI to S-level file */
+
+        compare("S-mode SMSI", call_smsi, direct_smsi);
+
+    CASE(3);    /* U-mode self-IPI and MSI, handled by S-mode */
+
+        tmon_call(TMON_FID_PRIV, U_MODE);           // to U
+
+        compare("U-mode SSWI", call_sswi, direct_sswi);
+        compare("U-mode SMSI", call_smsi, direct_smsi);
+
+        tmon_call(TMON_FID_PRIV, S_MODE);           // to S
+
+        s_all_enable(0);
+
+        smpu_disable();
+
+        tmon_call(TMON_FID_PRIV, M_MODE);           // to M
+
+        exit(0);
+}
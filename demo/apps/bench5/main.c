@@ -0,0 +1,138 @@
+/// @file   main.c
+/// @brief  RISC-V Test Monitor - PMU counter-overflow sampling benchmark #5.
+///         S-mode workload of three functions with 1:3:6 cost ratio is
+///         sampled every SAMPLE_PERIOD events of hpmcounter3 (Sscofpmf) and
+///         S/U-mode workload every PROF_INTERVAL mtime ticks (timer PC
+///         sampling), overhead is measured against unsampled run.
+
+
+#include "arch.h"
+#include "mtvec.h"
+#include "tmon.h"
+#include "cntr.h"
+#include "pmu.h"
+#include "mtmr.h"
+#include "prof.h"
+
+
+#ifndef SAMPLE_EVENT
+#define SAMPLE_EVENT    1       // implementation defined selector (cycles)
+#endif
+#ifndef SAMPLE_PERIOD
+#define SAMPLE_PERIOD   997     // events, prime to avoid aliasing with loops
+#endif
+
+#ifndef PROF_INTERVAL
+#define PROF_INTERVAL   10      // mtime ticks
+#endif
+
+#define SAMPLE_CTR      3
+#define LOAD_UNIT       1000    // loop iterations of the lightest function
+
+
+static volatile unsigned long sink;
+
+
+/// @name  load_light/medium/heavy( num )
+/// @brief workload functions, 1:3:6 cost ratio
+static void __attribute__((noinline)) load_light(unsigned long num) {
+
+        for (unsigned long i = 0; i < num; i++)
+                sink += i;
+}
+
+static void __attribute__((noinline)) load_medium(unsigned long num) {
+
+        for (unsigned long i = 0; i < 3 * num; i++)
+                sink += i;
+}
+
+static void __attribute__((noinline)) load_heavy(unsigned long num) {
+
+        for (unsigned long i = 0; i < 6 * num; i++)
+                sink += i;
+}
+
+
+/// @name  bench( name, mode )
+/// @brief run workload in S- or U-mode, cycles of the run are reported
+static void bench(const char *name, void *mode) {
+
+        cntr_scope_t sc = CNTR_SCOPE_INIT(name);
+
+        tmon_call(TMON_FID_PRIV, mode);         // to S/U
+
+        CNTR_SCOPE(&sc) {
+                load_light (LOAD_UNIT);
+                load_medium(LOAD_UNIT);
+                load_heavy (LOAD_UNIT);
+        }
+
+        tmon_call(TMON_FID_PRIV, M_MODE);       // to M
+
+        cntr_report(&sc);
+}
+
+
+int main(void)
+{
+
+        u64_t base, done;
+
+        printf("%s: PMU counter-overflow sampling benchmark\n", __func__);
+
+        /* M-mode setup, cycle and instret counters are readable in S/U-mode */
+
+        m_trap_mode(TRAP_MODE_DIRECT);
+
+        cntr_m_enable(CNTR_CY | CNTR_IR, 1);
+
+    CASE(1);
+
+        /* reference run, no sampling */
+
+        bench("reference", S_MODE);
+
+    CASE(2);
+
+        /* sampled run, LCOFI preempts S-mode workload */
+
+        if ( pmu_sample(SAMPLE_CTR, SAMPLE_EVENT, PMU_INH_M, SAMPLE_PERIOD) ) {
+                ERROR("PMU sampling setup failed\n");
+                exit(1);
+        }
+
+        base = pmu_read(SAMPLE_CTR);
+
+        pmu_start(1UL << SAMPLE_CTR);
+
+        bench("sampled", S_MODE);
+
+        pmu_stop(1UL << SAMPLE_CTR);
+
+        done = pmu_read(SAMPLE_CTR);
+
+        printf("  counter %d: 0x%llx -> 0x%llx, period %d\n", SAMPLE_CTR, base, done, SAMPLE_PERIOD);
+
+        pmu_dump();
+
+        pmu_reset();
+
+    CASE(3);
+
+        /* timer PC sampling, MTMR preempts S- and U-mode workload */
+
+        if ( mtmr_init() || prof_start(PROF_INTERVAL) ) {
+                ERROR("profiler setup failed\n");
+                exit(1);
+        }
+
+        bench("profiled S", S_MODE);
+        bench("profiled U", U_MODE);
+
+        prof_stop();
+
+        prof_flush();
+
+        exit(0);
+}
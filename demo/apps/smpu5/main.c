@@ -4,8 +4,11 @@
 
 
 #include "arch.h"
+#include "mtvec.h"
+#include "stvec.h"
 #include "tmon.h"
 #include "smpu.h"
+#include "vmpu.h"
 
 // Exports from linker script
 extern volatile long __htif_base[], __htif_size;
@@ -83,6 +86,11 @@ static const unsigned long PTE[][2] = {
 };
 
 
+/* VS-mode guest L1 MPU shadow configuration */
+
+static vmpu_guest_t guest;
+
+
 /// @name  func()
 /// @brief "relocatable" test function
 void __attribute__((noinline, optimize("O0"))) func(void) {
@@ -159,11 +167,22 @@ int main(void)
         m_exc_setvec(14, (void*)m_trap_cross_fault );
         m_exc_setvec(15, (void*)m_trap_store_fault );
 
+        /* Delegate U/VU and VS-mode ecalls, so S-level switches are served by HS-mode monitor */
+
+        m_exc_delegate(TRAP_EID_UCALL, 1);
+        m_exc_delegate(TRAP_EID_VCALL, 1);
+
+        /* Delegate virtual instruction traps, VS-mode L1 MPU accesses are emulated in HS-mode */
+
+        m_exc_delegate(TRAP_EID_VIRTUAL_INST, 1);
+
         /* Display memory map exported from linker script */
         memory_map();
 
         tmon_call(TMON_FID_PRIV, S_MODE);      // to S
 
+        s_trap_mode(TRAP_MODE_DIRECT);
+
         /* Configure amd enable L2 (HS-mode MPU) */
 
         hmpu_group_config( 0, 5, PTE );
@@ -173,6 +192,10 @@ int main(void)
 
         __csrs(CSR_HSTATUS, 1 << 12);
 
+        /* Start L1 (VS-mode) MPU emulation, L2 configuration above is the host one */
+
+        vmpu_init(&guest);
+
     /* Switch to VS-mode, check access to shared memory */
     CASE(1);
 
@@ -183,8 +206,6 @@ int main(void)
         smpu_group_config( 0, 5, &PTE[5] );
         smpu_group_enable( 1, 0x0000001F );    // enable shared S/U-mode protected regions
 
-        smpu_config_show(-1);
-
     /* Check privileges */
     CASE(2);
 
@@ -192,9 +213,13 @@ int main(void)
         tmon_call(TMON_FID_PRIV, VS_MODE);      // to VS
         tmon_call(TMON_FID_PRIV, U_MODE);       // to U
         tmon_call(TMON_FID_PRIV, S_MODE);       // to S
-        
 
+    /* Check effective L2 configuration (guest L1 combined with host L2) */
+    CASE(3);
+
+        hmpu_config_show(-1);
 
+        printf("L1 emulation: %ld traps, %ld L2 writes\n", vmpu_stats.traps, vmpu_stats.l2_writes);
 
         tmon_call(TMON_FID_PRIV, M_MODE);       // to M
 
@@ -37,13 +37,25 @@ int main(void)
         tmon_call(TMON_FID_PRIV, U_MODE);           // to U
 
 
-        /* CASE#5: */
+        /* CASE#5: quiet upward switch, downward switch without ecall */
         CASE(5);        
-        tmon_call(TMON_FID_PRIV, VU_MODE);           // to VU
+        tmon_priv_raise(M_MODE);                     // to M
+        m_priv_drop(S_MODE);                         // to S
 
 
         /* CASE#6: */
         CASE(6);        
+        tmon_priv_raise(M_MODE);                     // to M
+        m_priv_drop(U_MODE);                         // to U
+
+
+        /* CASE#7: */
+        CASE(7);        
+        tmon_call(TMON_FID_PRIV, VU_MODE);           // to VU
+
+
+        /* CASE#8: */
+        CASE(8);        
         tmon_call(TMON_FID_PRIV, VS_MODE);           // to VS
 
 
@@ -4,6 +4,7 @@
 #include "arch.h"
 #include "mtvec.h"
 #include "stvec.h"
+#include "vtvec.h"
 #include "tmon.h"
 
 
@@ -25,6 +26,8 @@ int main(void)
 
         s_trap_mode(TRAP_MODE_DIRECT);
 
+        s_exc_delegate(TRAP_EID_UCALL, 1);          // VU-mode ecalls are served by VS-mode monitor
+
         /* Test needs S-mode privileges */
 
         /* CASE#1: */
@@ -42,19 +45,32 @@ int main(void)
         tmon_call(TMON_FID_PRIV, M_MODE);            // to M
 
 
-        /* CASE#4:  */
+        /* CASE#4: M-mode ecall, served by M-mode monitor */
         CASE(4);        
-        tmon_call(TMON_FID_PRIV, VM_MODE);           // to M
+        tmon_call(TMON_FID_PRIV, VS_MODE);           // to VS
+
+        v_trap_mode(TRAP_MODE_DIRECT);
 
 
-        /* CASE#5: */
+        /* CASE#5: VS-mode ecall, served by HS-mode monitor */
         CASE(5);        
         tmon_call(TMON_FID_PRIV, VU_MODE);           // to VU
 
 
-        /* CASE#6: */
+        /* CASE#6: VU-mode ecall, served by VS-mode monitor */
         CASE(6);        
         tmon_call(TMON_FID_PRIV, VS_MODE);           // to VS
+        tmon_call(TMON_FID_PRIV, VU_MODE);           // to VU
+
+
+        /* CASE#7: VU-mode ecall, VS-mode monitor leaves the trap through HS-mode monitor */
+        CASE(7);        
+        tmon_call(TMON_FID_PRIV, S_MODE);            // to S
+
+
+        /* CASE#8: */
+        CASE(8);        
+        tmon_call(TMON_FID_PRIV, M_MODE);            // to M
 
 
         exit(0);
@@ -0,0 +1,267 @@
+/// @file   main.c
+/// @brief  RISC-V Demo Application  - deferred work queue, M/S-mode
+///         bottom-halves queued by trap callbacks (tmon/work.c), run with
+///         interrupts enabled and preempted by other sources
+
+#include "arch.h"
+#include "mtvec.h"
+#include "stvec.h"
+#include "tmon.h"
+#include "work.h"
+#include "cntr.h"
+
+
+#define MSI_EIID        10                      // M-level file interrupt identity
+#define BURST           8                       // items queued by one top-half
+#define CHAIN           4                       // items queued by bottom-halves
+#define SEEN_SIZE       64
+#define SPIN            100000                  // slow bottom-half, iterations
+
+#define MSTATUS_MIE     0x08
+#define SSTATUS_SIE     0x02
+
+static volatile unsigned long seen[SEEN_SIZE], nseen, unmasked, top, preempted;
+
+
+/// @name  record( arg )
+/// @brief bottom-half, records its argument and the interrupt state
+static void record(unsigned long arg) {
+
+        register unsigned long status;
+
+        if ( arg & 0x80000000 ) {
+                __csrr(status, CSR_SSTATUS);
+                status &= SSTATUS_SIE;
+        } else {
+                __csrr(status, CSR_MSTATUS);
+                status &= MSTATUS_MIE;
+        }
+
+        if ( status )
+                unmasked++;
+
+        if ( nseen < SEEN_SIZE )
+                seen[nseen++] = arg & ~0x80000000;
+}
+
+
+/// @name  chain( arg )
+/// @brief bottom-half, queues next item of the chain to the same queue
+static void chain(unsigned long arg) {
+
+        record(arg);
+
+        if ( arg < CHAIN )
+                work_queue(&m_work, chain, arg + 1);
+}
+
+
+/// @name  slow( arg )
+/// @brief long bottom-half, raises M-level file interrupt and waits for its
+///        top-half to preempt it
+static void slow(unsigned long arg) {
+
+        unsigned long n = top;
+
+        __mmsi_base[0] = MSI_EIID;
+
+        for (unsigned long i = 0; (i < SPIN) && (top == n); i++)
+                ;
+
+        if ( top != n )
+                preempted++;
+}
+
+
+/// @name  top_half( *s )
+/// @brief M-level file interrupt handler, queues BURST bottom-halves
+static void top_half(void *s) {
+
+        top++;
+
+        for (int i = 0; i < BURST; i++)
+                work_queue(&m_work, record, i);
+}
+
+
+/// @name  reset()
+/// @brief clear bottom-half record
+static void reset(void) {
+
+        nseen = unmasked = top = preempted = 0;
+}
+
+
+/// @name  check( *name, *wq, num, done, drops, enabled )
+/// @brief verify number and order of recorded items, number of items run
+///        with interrupts enabled and queue statistics
+static void check(const char *name, work_queue_t *wq, unsigned long num, unsigned long done,
+                  unsigned long drops, unsigned long enabled) {
+
+        if ( nseen != num || wq->done != done || wq->drops != drops ) {
+                ERROR("%s: %ld items run (%ld expected), %ld done, %ld drops (%ld/%ld expected)\n",
+                        name, nseen, num, wq->done, wq->drops, done, drops);
+                exit(1);
+        }
+
+        for (unsigned long i = 0; i < nseen; i++) {
+                if ( seen[i] != i ) {
+                        ERROR("%s: item #%ld has arg %ld, out of order\n", name, i, seen[i]);
+                        exit(1);
+                }
+        }
+
+        if ( unmasked != enabled ) {
+                ERROR("%s: %ld bottom-halves run with interrupts enabled (%ld expected)\n", name, unmasked, enabled);
+                exit(1);
+        }
+
+        if ( wq->head != wq->tail ) {
+                ERROR("%s: %ld items left in queue\n", name, wq->head - wq->tail);
+                exit(1);
+        }
+
+        work_report(wq);
+}
+
+
+int main(void)
+{
+
+        TRACE("RISC-V Demo App - deferred work queue\n");
+
+        /* M-mode setup */
+
+        m_trap_mode(TRAP_MODE_DIRECT);
+
+        m_ext_setvec(MSI_EIID, top_half);
+        m_ext_enable(MSI_EIID, 1);
+        m_ext_delivery(1);
+        m_ext_threshold(0);
+        m_maj_enable(TRAP_IID_MEXT, 1);
+
+    CASE(1);    /* top-half queues a burst, bottom-halves run on MSWI */
+
+        m_all_enable(0);
+
+        if ( m_work_init(WORK_TRIGGER_SWI) ) {
+                ERROR("MSWI work trigger setup failed\n");
+                exit(1);
+        }
+
+        reset();
+
+        tmon_call(TMON_FID_MMSI, MSI_EIID);             // assert M-level file interrupt
+
+        m_all_enable(1);                                // top-half, then MSWI bottom-halves
+
+        if ( 1 != top ) {
+                ERROR("top-half run %ld times\n", top);
+                exit(1);
+        }
+
+        check("burst", &m_work, BURST, BURST, 0, BURST);
+
+    CASE(2);    /* full queue drops items, no allocation */
+
+        m_all_enable(0);
+
+        m_work_init(WORK_TRIGGER_SWI);
+
+        reset();
+
+        for (int i = 0; i < WORK_QUEUE_SIZE + 4; i++)
+                work_queue(&m_work, record, i);
+
+        m_all_enable(1);                                // MSWI bottom-halves
+
+        check("overflow", &m_work, WORK_QUEUE_SIZE, WORK_QUEUE_SIZE, 4, WORK_QUEUE_SIZE);
+
+    CASE(3);    /* items queued by bottom-halves are run by the same drain */
+
+        m_all_enable(0);
+
+        m_work_init(WORK_TRIGGER_SWI);
+
+        reset();
+
+        work_queue(&m_work, chain, 0);
+
+        m_all_enable(1);
+
+        check("chain", &m_work, CHAIN + 1, CHAIN + 1, 0, CHAIN + 1);
+
+    CASE(4);    /* long bottom-half is preempted by M-level file interrupt */
+
+        m_all_enable(0);
+
+        m_work_init(WORK_TRIGGER_SWI);
+
+        reset();
+
+        work_queue(&m_work, slow, 0);
+
+        m_all_enable(1);                                // top-half runs within slow bottom-half
+
+        if ( 1 != top || 1 != preempted ) {
+                ERROR("top-half run %ld times, %ld times within bottom-half\n", top, preempted);
+                exit(1);
+        }
+
+        check("preempt", &m_work, BURST, BURST + 1, 0, BURST);
+
+    CASE(5);    /* bottom-halves run at monitor exit point (ecall return),
+                   masked as the caller has interrupts disabled */
+
+        m_all_enable(0);
+
+        m_work_init(WORK_TRIGGER_EXIT);
+
+        reset();
+
+        for (int i = 0; i < BURST; i++)
+                work_queue(&m_work, record, i);
+
+        if ( nseen ) {
+                ERROR("%ld bottom-halves run before monitor exit\n", nseen);
+                exit(1);
+        }
+
+        tmon_call(TMON_FID_MSWI, 0);                    // any request, queue is drained on return
+
+        check("exit", &m_work, BURST, BURST, 0, 0);
+
+        m_work_init(WORK_TRIGGER_NONE);
+
+    CASE(6);    /* S-mode queue, SSWI is raised by monitor request (no MMIO map) */
+
+        m_maj_delegate(TRAP_IID_SSWI, 1);
+
+        cntr_m_enable(CNTR_CY, 0);                      // cycle in S-mode, queue latency
+
+        tmon_call(TMON_FID_PRIV, S_MODE);               // to S
+
+        s_trap_mode(TRAP_MODE_DIRECT);
+
+        if ( s_work_init(WORK_TRIGGER_SWI) ) {
+                ERROR("SSWI work trigger setup failed\n");
+                exit(1);
+        }
+
+        reset();
+
+        s_all_enable(0);
+
+        for (unsigned long i = 0; i < BURST; i++)
+                work_queue(&s_work, record, 0x80000000 | i);
+
+        s_all_enable(1);                                // SSWI bottom-halves
+
+        check("S-mode", &s_work, BURST, BURST, 0, BURST);
+
+        s_all_enable(0);
+
+        tmon_call(TMON_FID_PRIV, M_MODE);               // to M
+
+        exit(0);
+}
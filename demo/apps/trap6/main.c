@@ -0,0 +1,336 @@
+/// @file   main.c
+/// @brief  RISC-V Demo Application  - M-mode timers (tmon/mtmr.c) on the
+///         tickless timer wheel (tmon/twheel.c), timers across all wheel
+///         levels, cancellation and periodic re-linking, S-mode timers
+///         on stimecmp (tmon/stmr.c, Sstc)
+
+#include "arch.h"
+#include "mtvec.h"
+#include "stvec.h"
+#include "tmon.h"
+#include "cntr.h"
+#include "mtmr.h"
+#include "stmr.h"
+
+
+#define NUM             256                     // one-shot timers
+#define S_NUM           48                      // S-mode one-shot timers, levels 0..2
+#define PER             16                      // periodic timers
+#define EVENTS          4096                    // periodic expiries to run
+
+#define PER_BASE        100                     // periods exceed expiry latency,
+#define PER_STEP        37                      // so periodic timers never catch up
+#define KILL_DELAY      2000                    // cancelling timer, before class 2
+
+#define SLACK           (1UL << 20)             // ticks, wait timeout beyond deadline
+
+typedef struct tmr_s {
+        twheel_timer_t  t;
+        u64_t           first;                  // expiry of the first run
+        unsigned long   fires;
+} tmr_t;
+
+/* delay classes, one per wheel level 0..3 (mtime ticks, TWHEEL_RES_SHIFT=0) */
+
+static const unsigned long span[4][2] = {
+        {      1,    63 },                      // level 0
+        {     64,  4095 },                      // level 1, one cascade
+        {   4096, 32767 },                      // level 2, two cascades
+        { 262144, 266239 },                     // level 3, three cascades
+};
+
+static tmr_t tmr[NUM], per[PER], kill;
+
+static volatile unsigned long fired;
+static unsigned long early, disorder, drift, rnd = 1;
+static u64_t last, late_max, late_sum;
+
+
+/// @name  delay( level )
+/// @brief pseudo-random delay of level class
+static u64_t delay(unsigned long level) {
+
+        rnd = rnd * 1103515245 + 12345;
+
+        return span[level][0] + (rnd >> 8) % (span[level][1] - span[level][0] + 1);
+}
+
+
+/// @name  account( *t, now )
+/// @brief check expiry is not early, global expiry order and exact periodic
+///        re-linking
+static void account(twheel_timer_t *t, u64_t now) {
+
+        tmr_t *p = (tmr_t*)t->arg;
+
+        if ( now < t->expires ) {
+                early++;
+        } else {
+                late_sum += now - t->expires;
+                if ( now - t->expires > late_max )
+                        late_max = now - t->expires;
+        }
+
+        if ( t->expires < last )
+                disorder++;
+
+        if ( t->expires != p->first + p->fires * t->period )
+                drift++;
+
+        last = t->expires;
+
+        p->fires++;
+        fired++;
+}
+
+
+/// @name  expire( *s ), s_expire( *s )
+/// @brief M-mode and S-mode timer callbacks
+static void expire  (void *s) { account(mtmr_current(), mtmr_time()); }
+static void s_expire(void *s) { account(stmr_current(), stmr_time()); }
+
+
+/// @name  cancel( *s )
+/// @brief timer callback, stops pending class 2 timers from the timer
+///        interrupt context
+static void cancel(void *s) {
+
+        expire(s);
+
+        for (int i = 2; i < NUM; i += 4) {
+                if ( mtmr_stop(&tmr[i].t) ) {
+                        ERROR("class 2 timer #%d is not pending at %lld\n", i, mtmr_time());
+                        exit(1);
+                }
+        }
+}
+
+
+/// @name  start( *p, delay, period, fn )
+/// @brief start M-mode timer (S-mode timer for s_expire callback), record
+///        expiry of the first run
+static void start(tmr_t *p, u64_t delay, u64_t period, twheel_fn_t fn) {
+
+        p->fires = 0;
+
+        if ( ((s_expire == fn) ? stmr_start : mtmr_start)(&p->t, delay, period, fn, p) ) {
+                ERROR("timer start failed\n");
+                exit(1);
+        }
+
+        p->first = p->t.expires;
+}
+
+
+/// @name  reset()
+/// @brief clear expiry statistics
+static void reset(void) {
+
+        fired = early = disorder = drift = 0;
+        last = late_max = late_sum = 0;
+}
+
+
+/// @name  wait( num, until, now )
+/// @brief wait for num expiries and time to pass until
+static void wait(unsigned long num, u64_t until, u64_t (*now)(void)) {
+
+        u64_t timeout = until + SLACK;
+
+        while ( fired < num || now() <= until ) {
+                if ( now() > timeout ) {
+                        ERROR("%ld of %ld timers expired before timeout\n", fired, num);
+                        exit(1);
+                }
+        }
+}
+
+
+/// @name  check( *name )
+/// @brief verify expiry statistics, print latency
+static void check(const char *name) {
+
+        if ( early || disorder || drift ) {
+                ERROR("%s: %ld early, %ld out of order, %ld drifted expiries\n", name, early, disorder, drift);
+                exit(1);
+        }
+
+        printf("  %s: %ld expiries, latency %lld/%lld ticks (avg/max)\n",
+                name, fired, (fired) ? late_sum / fired : 0, late_max);
+}
+
+
+int main(void)
+{
+
+        u64_t         until;
+        unsigned long num;
+
+        TRACE("RISC-V Demo App - M/S-mode timers, timer wheel\n");
+
+        /* M-mode setup */
+
+        m_trap_mode(TRAP_MODE_DIRECT);
+
+        if ( mtmr_init() ) {
+                ERROR("M-mode timer setup failed\n");
+                exit(1);
+        }
+
+    CASE(1);    /* one-shot timers of all levels, cascading */
+
+        m_all_enable(0);
+
+        reset();
+
+        for (int i = 0; i < NUM; i++)
+                start(&tmr[i], delay(i % 4), 0, expire);
+
+        if ( NUM != m_twheel.count ) {
+                ERROR("%ld timers pending, %d started\n", m_twheel.count, NUM);
+                exit(1);
+        }
+
+        until = mtmr_time() + span[3][1];
+
+        m_all_enable(1);
+
+        wait(NUM, until, mtmr_time);
+
+        for (int i = 0; i < NUM; i++) {
+                if ( 1 != tmr[i].fires ) {
+                        ERROR("timer #%d expired %ld times\n", i, tmr[i].fires);
+                        exit(1);
+                }
+        }
+
+        check("one-shot");
+
+    CASE(2);    /* cancellation: before expiry, from callback, restart */
+
+        m_all_enable(0);
+
+        reset();
+
+        for (int i = 0; i < NUM; i++)
+                start(&tmr[i], delay(i % 4), 0, expire);
+
+        for (int i = 1; i < NUM; i += 2) {
+                if ( mtmr_stop(&tmr[i].t) || (0 == mtmr_stop(&tmr[i].t)) ) {
+                        ERROR("timer #%d stop failed\n", i);
+                        exit(1);
+                }
+        }
+
+        for (int i = 0; i < NUM; i += 4)               // restart of pending timer re-links it
+                start(&tmr[i], delay(i % 4), 0, expire);
+
+        start(&kill, KILL_DELAY, 0, cancel);
+
+        num   = NUM / 4 + 1;
+        until = mtmr_time() + span[2][1];
+
+        m_all_enable(1);
+
+        wait(num, until, mtmr_time);
+
+        for (int i = 0; i < NUM; i++) {
+                if ( tmr[i].fires != ((i % 4) ? 0 : 1) ) {
+                        ERROR("timer #%d expired %ld times\n", i, tmr[i].fires);
+                        exit(1);
+                }
+        }
+
+        if ( fired != num || m_twheel.count ) {
+                ERROR("%ld expiries (%ld expected), %ld timers pending\n", fired, num, m_twheel.count);
+                exit(1);
+        }
+
+        check("cancel");
+
+    CASE(3);    /* periodic timers, thousands of expiries */
+
+        m_all_enable(0);
+
+        reset();
+
+        for (int i = 0; i < PER; i++)
+                start(&per[i], PER_BASE + PER_STEP * i, PER_BASE + PER_STEP * i, expire);
+
+        m_all_enable(1);
+
+        wait(EVENTS, mtmr_time(), mtmr_time);
+
+        m_all_enable(0);
+
+        until = mtmr_time();
+
+        for (int i = 0; i < PER; i++) {
+
+                num = (until - per[i].first) / per[i].t.period + 1;     // expiries up to now
+
+                if ( mtmr_stop(&per[i].t) || per[i].fires > num ||
+                     per[i].fires + late_max / per[i].t.period + 1 < num ) {
+                        ERROR("periodic timer #%d: %ld expiries, %ld expected\n", i, per[i].fires, num);
+                        exit(1);
+                }
+        }
+
+        if ( m_twheel.count ) {
+                ERROR("%ld timers pending\n", m_twheel.count);
+                exit(1);
+        }
+
+        check("periodic");
+
+    CASE(4);    /* S-mode timers, stimecmp is programmed by S-mode (Sstc) */
+
+        m_maj_delegate(TRAP_IID_STMR, 1);
+
+        tmon_call(TMON_FID_PRIV, S_MODE);               // to S
+
+        s_trap_mode(TRAP_MODE_DIRECT);
+
+        if ( stmr_init() ) {
+                ERROR("S-mode timer setup failed\n");
+                exit(1);
+        }
+
+        s_all_enable(0);
+
+        reset();
+
+        for (int i = 0; i < S_NUM; i++)
+                start(&tmr[i], delay(i % 3), 0, s_expire);
+
+        if ( twheel_next(&s_twheel) != CNTR_READ64(CSR_STIMECMPH, CSR_STIMECMP) ) {
+                ERROR("stimecmp is not programmed for the nearest deadline\n");
+                exit(1);
+        }
+
+        until = stmr_time() + span[2][1];
+
+        s_all_enable(1);
+
+        wait(S_NUM, until, stmr_time);
+
+        s_all_enable(0);
+
+        for (int i = 0; i < S_NUM; i++) {
+                if ( 1 != tmr[i].fires ) {
+                        ERROR("S-mode timer #%d expired %ld times\n", i, tmr[i].fires);
+                        exit(1);
+                }
+        }
+
+        if ( s_twheel.count || TWHEEL_NEVER != CNTR_READ64(CSR_STIMECMPH, CSR_STIMECMP) ) {
+                ERROR("%ld S-mode timers pending, stimecmp is not parked\n", s_twheel.count);
+                exit(1);
+        }
+
+        check("Sstc");
+
+        tmon_call(TMON_FID_PRIV, M_MODE);               // to M
+
+        exit(0);
+}
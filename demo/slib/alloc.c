@@ -0,0 +1,194 @@
+/// @file   alloc.c
+/// @brief  RISC-V Shared Library - arena (bump) and fixed-size block pool
+///         allocators, any privilege level
+
+#include "arch.h"
+#include "alloc.h"
+
+
+/* linker script heap */
+
+extern long __heap_base, __heap_size;
+
+arena_t heap_arena;
+
+
+/// @name   heap_init()
+/// @brief  heap_arena over the linker script heap, everything allocated
+///         before is released
+ret_t heap_init(void) {
+
+    return arena_init(&heap_arena, &__heap_base, (unsigned long)&__heap_size + 32);
+}
+
+
+/// @name   arena_init( *a, *base, size )
+/// @brief  empty arena over [base, base + size)
+ret_t arena_init(arena_t *a, void *base, unsigned long size) {
+
+    *a = (arena_t){
+        .base = (unsigned long)base,
+        .top  = (unsigned long)base + size,
+        .cur  = (unsigned long)base,
+    };
+
+    return (ret_t){ 0, size };
+}
+
+
+/// @name   arena_alloc( *a, size, align )
+/// @brief  bump allocation, align is a power of 2 (0 - ALLOC_ALIGN)
+/// @return block address, 0 - arena is exhausted
+void *arena_alloc(arena_t *a, unsigned long size, unsigned long align) {
+
+    register unsigned long blk;
+
+    if ( 0 == align )
+        align = ALLOC_ALIGN;
+
+    blk = ALLOC_ROUND(a->cur, align);
+
+    if ( blk < a->cur || blk > a->top || size > a->top - blk ) {
+        a->fails++;
+        return 0;
+    }
+
+    a->cur = blk + size;
+    a->allocs++;
+
+    if ( a->cur - a->base > a->peak )
+        a->peak = a->cur - a->base;
+
+    return (void *)blk;
+}
+
+
+/// @name   arena_mark( *a )
+/// @brief  current position, released back to with arena_reset()
+unsigned long arena_mark(arena_t *a) {
+
+    return a->cur;
+}
+
+
+/// @name   arena_reset( *a, mark )
+/// @brief  release all allocations after mark (a->base releases all)
+ret_t arena_reset(arena_t *a, unsigned long mark) {
+
+    if ( mark < a->base || mark > a->cur )
+        return (ret_t){ -1, 0 };
+
+    a->cur = mark;
+
+    return (ret_t){ 0, a->top - a->cur };
+}
+
+
+/// @name   arena_report( *a, *name )
+/// @brief  print arena statistics
+void arena_report(arena_t *a, const char *name) {
+
+    printf("  arena %s: 0x%lx - 0x%lx, used %lu, peak %lu, free %lu, allocs %lu, fails %lu\n",
+            name, a->base, a->top, arena_used(a), a->peak, arena_free(a), a->allocs, a->fails);
+}
+
+
+/// @name   pool_init( *p, *mem, block, num )
+/// @brief  pool of num blocks over caller memory (block * num bytes, block
+///         is rounded up to ALLOC_ALIGN), all blocks are linked to free list
+ret_t pool_init(pool_t *p, void *mem, unsigned long block, unsigned long num) {
+
+    register unsigned long i;
+    register void        **blk;
+
+    block = ALLOC_ROUND((block) ? block : 1, ALLOC_ALIGN);
+
+    *p = (pool_t){
+        .free      = (num) ? mem : 0,
+        .base      = (unsigned long)mem,
+        .block     = block,
+        .num       = num,
+        .avail     = num,
+        .min_avail = num,
+    };
+
+    for (i = 0; i < num; i++) {
+        blk  = (void **)((unsigned long)mem + i * block);
+        *blk = (i + 1 < num) ? (void *)((unsigned long)blk + block) : 0;
+    }
+
+    return (ret_t){ 0, num };
+}
+
+
+/// @name   pool_create( *p, *a, block, num )
+/// @brief  pool of num blocks carved from arena, block is rounded up to
+///         ALLOC_ALIGN, pool size (block * num) must not overflow
+ret_t pool_create(pool_t *p, arena_t *a, unsigned long block, unsigned long num) {
+
+    register void *mem = 0;
+
+    block = ( block > ~0UL - (ALLOC_ALIGN - 1) ) ? 0 : ALLOC_ROUND((block) ? block : 1, ALLOC_ALIGN);
+
+    if ( block && num && block <= ~0UL / num )
+        mem = arena_alloc(a, block * num, ALLOC_ALIGN);
+
+    if ( 0 == mem ) {
+        *p = (pool_t){};
+        return (ret_t){ -1, 0 };
+    }
+
+    return pool_init(p, mem, block, num);
+}
+
+
+/// @name   pool_alloc( *p )
+/// @brief  take block from free list
+/// @return block address, 0 - pool is empty
+void *pool_alloc(pool_t *p) {
+
+    register void **blk = (void **)p->free;
+
+    if ( 0 == blk ) {
+        p->fails++;
+        return 0;
+    }
+
+    p->free = *blk;
+    p->avail--;
+    p->allocs++;
+
+    if ( p->avail < p->min_avail )
+        p->min_avail = p->avail;
+
+    return blk;
+}
+
+
+/// @name   pool_free( *p, *blk )
+/// @brief  return block to free list, block must belong to the pool
+ret_t pool_free(pool_t *p, void *blk) {
+
+    register unsigned long off = (unsigned long)blk - p->base;
+
+    if ( (unsigned long)blk < p->base || off >= p->block * p->num || (off % p->block) ) {
+        ERROR("block 0x%lx does not belong to pool 0x%lx\n", (unsigned long)blk, p->base);
+        return (ret_t){ -1, 0 };
+    }
+
+    *(void **)blk = p->free;
+    p->free = blk;
+    p->avail++;
+    p->frees++;
+
+    return (ret_t){ 0, p->avail };
+}
+
+
+/// @name   pool_report( *p, *name )
+/// @brief  print pool statistics
+void pool_report(pool_t *p, const char *name) {
+
+    printf("  pool %s: %lu x %lu bytes @0x%lx, free %lu (min %lu), allocs %lu, frees %lu, fails %lu\n",
+            name, p->num, p->block, p->base, p->avail, p->min_avail, p->allocs, p->frees, p->fails);
+}
@@ -0,0 +1,73 @@
+/// @file   alloc.h
+/// @brief  RISC-V Shared Library - arena (bump) and fixed-size block pool
+///         allocators, header file
+
+
+#pragma once
+
+#include "tmon.h"
+
+/*
+    O(1) deterministic allocation, no headers per allocation:
+
+    arena   - bump allocator over [base, base + size), arena_mark() and
+              arena_reset() release everything allocated after the mark
+    pool    - fixed-size blocks with free list (next pointer stored in the
+              free block), memory is taken from an arena or given by caller
+
+    heap_init() sets up heap_arena over the linker script heap
+    (__heap_base, __heap_size + 32). Allocators take no locks and do not
+    touch interrupt state: an instance is usable from any mode and from
+    trap context, an instance shared by thread and trap context needs
+    interrupts masked by the caller around thread context calls.
+
+    Statistics (current/peak use, counts of allocations and failures) are
+    kept per instance, arena_report()/pool_report() print them.
+*/
+
+#define ALLOC_ALIGN     sizeof(void*)   // default alignment
+
+#define ALLOC_ROUND(__v__, __a__)   (((__v__) + (__a__) - 1) & ~((__a__) - 1))
+
+typedef struct arena_s {
+    unsigned long   base;           // [base, top)
+    unsigned long   top;
+    unsigned long   cur;            // next free byte
+    unsigned long   peak;           // max used bytes
+    unsigned long   allocs;
+    unsigned long   fails;
+} arena_t;
+
+typedef struct pool_s {
+    void           *free;           // free list head
+    unsigned long   base;           // [base, base + block * num)
+    unsigned long   block;          // block size, ALLOC_ALIGN multiple
+    unsigned long   num;            // number of blocks
+    unsigned long   avail;          // free blocks
+    unsigned long   min_avail;      // low water mark
+    unsigned long   allocs;
+    unsigned long   frees;
+    unsigned long   fails;
+} pool_t;
+
+extern arena_t heap_arena;
+
+/* arena */
+
+ret_t         heap_init   ( void );
+ret_t         arena_init  ( arena_t *a, void *base, unsigned long size );
+void         *arena_alloc ( arena_t *a, unsigned long size, unsigned long align );
+unsigned long arena_mark  ( arena_t *a );
+ret_t         arena_reset ( arena_t *a, unsigned long mark );
+void          arena_report( arena_t *a, const char *name );
+
+#define arena_used(__a__)   ((__a__)->cur - (__a__)->base)
+#define arena_free(__a__)   ((__a__)->top - (__a__)->cur)
+
+/* fixed-size block pool */
+
+ret_t         pool_init   ( pool_t *p, void *mem, unsigned long block, unsigned long num );
+ret_t         pool_create ( pool_t *p, arena_t *a, unsigned long block, unsigned long num );
+void         *pool_alloc  ( pool_t *p );
+ret_t         pool_free   ( pool_t *p, void *blk );
+void          pool_report ( pool_t *p, const char *name );
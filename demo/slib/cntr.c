@@ -0,0 +1,118 @@
+/// @file   cntr.c
+/// @brief  RISC-V Shared Library - counter access (cycle, time, instret)
+
+#include "arch.h"
+#include "cntr.h"
+
+
+/// @name   cntr_{cycle|time|instret}()
+/// @brief  unprivileged counters, any privilege level (xcounteren)
+u64_t cntr_cycle(void) {
+
+    return CNTR_READ64(CSR_CYCLEH, CSR_CYCLE);
+}
+
+u64_t cntr_time(void) {
+
+    return CNTR_READ64(CSR_TIMEH, CSR_TIME);
+}
+
+u64_t cntr_instret(void) {
+
+    return CNTR_READ64(CSR_INSTRETH, CSR_INSTRET);
+}
+
+
+/// @name   cntr_{mcycle|minstret}()
+/// @brief  machine counters, M-mode code
+u64_t cntr_mcycle(void) {
+
+    return CNTR_READ64(CSR_MCYCLEH, CSR_MCYCLE);
+}
+
+u64_t cntr_minstret(void) {
+
+    return CNTR_READ64(CSR_MINSTRETH, CSR_MINSTRET);
+}
+
+
+/// @name   cntr_m_enable( mask, umode )
+/// @brief  enable counters (CNTR_CY/TM/IR) for S-mode, and for U-mode too
+///         if umode, M-mode code
+ret_t cntr_m_enable(unsigned long mask, int umode) {
+
+    __csrs(CSR_MCOUNTEREN, mask);
+
+    if (umode)
+        __csrs(CSR_SCOUNTEREN, mask);
+
+    return (ret_t){ 0, mask };
+}
+
+
+/// @name   cntr_s_enable( mask, umode )
+/// @brief  enable counters for S-mode with monitor request, and for U-mode
+///         too if umode, S-mode code
+ret_t cntr_s_enable(unsigned long mask, int umode) {
+
+    tmon_csr_t req = { CSR_MCOUNTEREN, mask };
+
+    tmon_call(TMON_FID_CSRS, &req);
+
+    if (umode)
+        __csrs(CSR_SCOUNTEREN, mask);
+
+    return (ret_t){ 0, mask };
+}
+
+
+/// @name   cntr_h_enable( mask )
+/// @brief  enable counters for VS/VU-mode (hcounteren), HS-mode code,
+///         counters have to be enabled for HS-mode
+ret_t cntr_h_enable(unsigned long mask) {
+
+    __csrs(CSR_HCOUNTEREN, mask);
+
+    return (ret_t){ 0, mask };
+}
+
+
+/// @name   cntr_start( *sc )
+/// @brief  start scope measurement
+void cntr_start(cntr_scope_t *sc) {
+
+    sc->instret = cntr_instret();
+    sc->cycle   = cntr_cycle();
+}
+
+
+/// @name   cntr_stop( *sc )
+/// @brief  stop scope measurement and accumulate
+/// @return cycles of the scope
+unsigned long cntr_stop(cntr_scope_t *sc) {
+
+    register unsigned long cycles;
+
+    cycles = (unsigned long)(cntr_cycle() - sc->cycle);
+
+    sc->instrets += cntr_instret() - sc->instret;
+    sc->cycles   += cycles;
+    sc->num++;
+
+    if (cycles < sc->min) sc->min = cycles;
+    if (cycles > sc->max) sc->max = cycles;
+
+    return cycles;
+}
+
+
+/// @name   cntr_report( *sc )
+/// @brief  print scope statistics
+void cntr_report(cntr_scope_t *sc) {
+
+    register unsigned long num = (sc->num) ? sc->num : 1;
+
+    printf("  %s: %ld scopes, %ld/%ld/%ld cycles (min/avg/max), %ld instret (avg)\n",
+        sc->name, sc->num, (sc->num) ? sc->min : 0, (unsigned long)(sc->cycles / num), sc->max,
+        (unsigned long)(sc->instrets / num));
+}
@@ -0,0 +1,80 @@
+/// @file   cntr.h
+/// @brief  RISC-V Shared Library - counter access (cycle, time, instret),
+///         header file
+
+
+#pragma once
+
+#include "tmon.h"
+
+/*
+    Counters are read with consistent 64-bit hi/lo/hi reads on rv32 (low
+    part is re-read if high part changes): CNTR_READ64() for CSR pairs,
+    CNTR_READ64_BY() with reader macro rd(val, reg) for MMIO or indexed
+    counters (the macros are used by tmon timers and PMU as well).
+    Unprivileged counters (cycle, time, instret) are readable in
+    S/U/VS/VU-mode without monitor request once enabled with xcounteren:
+
+    cntr_m_enable()     M-mode code, mcounteren (and scounteren for U-mode)
+    cntr_s_enable()     S-mode code, mcounteren with monitor request
+    cntr_h_enable()     HS-mode code, hcounteren for VS/VU-mode
+
+    Scoped measurement accumulates cycles/instret of code block:
+
+    static cntr_scope_t sc = CNTR_SCOPE_INIT("name");
+    CNTR_SCOPE(&sc) { ... }     // no break/return inside the block
+    cntr_report(&sc);
+*/
+
+#define CNTR_CY     (1 << 0)        // cycle
+#define CNTR_TM     (1 << 1)        // time
+#define CNTR_IR     (1 << 2)        // instret
+
+#define CNTR_READ64_BY(__rd__, __hi__, __lo__) ({          \
+    register unsigned long __h__, __l__, __h2__;            \
+    do {                                                    \
+        __rd__(__h__,  __hi__);                             \
+        __rd__(__l__,  __lo__);                             \
+        __rd__(__h2__, __hi__);                             \
+    } while ( __h__ != __h2__ );                            \
+    ((u64_t)__h__ << 32) | __l__;                           \
+})
+
+#define CNTR_READ64(__hi__, __lo__)     CNTR_READ64_BY(__csrr, __hi__, __lo__)
+
+typedef struct cntr_scope_s {
+    const char     *name;
+    u64_t           cycle;          // start stamps
+    u64_t           instret;
+    u64_t           cycles;         // accumulated
+    u64_t           instrets;
+    unsigned long   min;            // cycles per scope
+    unsigned long   max;
+    unsigned long   num;            // number of measured scopes
+} cntr_scope_t;
+
+#define CNTR_SCOPE_INIT(__name__)   { .name = (__name__), .min = ~0UL, }
+
+#define CNTR_SCOPE(__sc__)                                              \
+    for (int __cntr_once__ = (cntr_start(__sc__), 1); __cntr_once__;    \
+         __cntr_once__ = (cntr_stop(__sc__), 0))
+
+/* 64-bit reads */
+
+u64_t cntr_cycle    ( void );
+u64_t cntr_time     ( void );
+u64_t cntr_instret  ( void );
+u64_t cntr_mcycle   ( void );
+u64_t cntr_minstret ( void );
+
+/* lower privilege access */
+
+ret_t cntr_m_enable ( unsigned long mask, int umode );
+ret_t cntr_s_enable ( unsigned long mask, int umode );
+ret_t cntr_h_enable ( unsigned long mask );
+
+/* scoped measurement */
+
+void          cntr_start  ( cntr_scope_t *sc );
+unsigned long cntr_stop   ( cntr_scope_t *sc );
+void          cntr_report ( cntr_scope_t *sc );
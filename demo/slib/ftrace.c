@@ -0,0 +1,87 @@
+/// @file   ftrace.c
+/// @brief  RISC-V Shared Library - function-level cycle tracing
+///         (-finstrument-functions hooks), any privilege level
+
+#include "arch.h"
+#include "ftrace.h"
+
+
+/* trace ring */
+
+ftrace_ring_t ftrace_ring;
+
+
+/// @name   ftrace_log( fn )
+/// @brief  append record to the ring, cycle delta since previous record
+static inline void __attribute__((no_instrument_function, always_inline)) ftrace_log(unsigned long fn) {
+
+    register unsigned long cycle;
+    register ftrace_rec_t *r;
+
+    __csrr(cycle, CSR_CYCLE);
+
+    r = &ftrace_ring.rec[ftrace_ring.num++ & (FTRACE_RING_NUM - 1)];
+
+    r->fn    = fn;
+    r->delta = cycle - ftrace_ring.last;
+
+    ftrace_ring.last = cycle;
+}
+
+
+/// @name   ftrace_on()
+/// @brief  the first hook is main() entry in M-mode, cycle counter is
+///         enabled for lower modes
+static void __attribute__((no_instrument_function)) ftrace_on(void) {
+
+    __csrs(CSR_MCOUNTEREN, 1);
+    __csrs(CSR_SCOUNTEREN, 1);
+    __csrs(CSR_HCOUNTEREN, 1);
+
+    __csrr(ftrace_ring.last, CSR_CYCLE);
+
+    ftrace_ring.state = FTRACE_ON;
+}
+
+
+/// @name   __cyg_profile_func_enter( *fn, *site )
+/// @brief  instrumented function entry hook
+void __cyg_profile_func_enter(void *fn, void *site) {
+
+    if ( FTRACE_OFF == ftrace_ring.state )
+        ftrace_on();
+
+    if ( FTRACE_ON == ftrace_ring.state )
+        ftrace_log((unsigned long)fn);
+}
+
+
+/// @name   __cyg_profile_func_exit( *fn, *site )
+/// @brief  instrumented function exit hook
+void __cyg_profile_func_exit(void *fn, void *site) {
+
+    if ( FTRACE_ON == ftrace_ring.state )
+        ftrace_log((unsigned long)fn | FTRACE_EXIT);
+}
+
+
+/// @name   ftrace_flush()
+/// @brief  print the ring oldest first, one "ftrace: <e|x> <fn> <delta>"
+///         line per record (tools/ftrace_report.py input), tracing is stopped
+void ftrace_flush(void) {
+
+    register unsigned long i, first, fn;
+    register unsigned long num = ftrace_ring.num;
+
+    ftrace_ring.state = FTRACE_DONE;    // flush and later code is not traced
+
+    first = (num > FTRACE_RING_NUM) ? num - FTRACE_RING_NUM : 0;
+
+    printf("ftrace: records %lu, lost %lu\n", num - first, first);
+
+    for (i = first; i < num; i++) {
+        fn = ftrace_ring.rec[i & (FTRACE_RING_NUM - 1)].fn;
+        printf("ftrace: %c 0x%lx %lu\n", (fn & FTRACE_EXIT) ? 'x' : 'e',
+                fn & ~FTRACE_EXIT, ftrace_ring.rec[i & (FTRACE_RING_NUM - 1)].delta);
+    }
+}
@@ -0,0 +1,53 @@
+/// @file   ftrace.h
+/// @brief  RISC-V Shared Library - function-level cycle tracing
+///         (-finstrument-functions hooks), header file
+
+
+#pragma once
+
+#include "tmon.h"
+
+/*
+    Build mode FTRACE=1 (make FTRACE=1 clean all) compiles apps and slib
+    with -finstrument-functions, tmon, printf.c and ftrace.c are not
+    instrumented:
+
+    - function entry/exit hooks log (function address, cycle delta) to RAM
+      ring, bit 0 of the address marks exit, no formatting at run time
+    - delta is the low part of cycle counter since the previous record,
+      the ring keeps the last FTRACE_RING_NUM records (older are lost)
+    - the first hook (main() entry from crt0, M-mode) enables cycle
+      counter for S/U/VS/VU-mode, code which clears CY in xcounteren later
+      can not be traced in lower modes
+    - exit() flushes the ring through the host link, "ftrace: <e|x> <fn>
+      <delta>" lines are tools/ftrace_report.py input (inclusive/exclusive
+      cycles per function, trace viewer JSON)
+*/
+
+#ifndef FTRACE_RING_NUM
+#define FTRACE_RING_NUM     4096    // power of 2
+#endif
+
+#define FTRACE_EXIT         1UL     // address bit 0, exit record
+
+#define FTRACE_OFF          0       // not started (counters not enabled)
+#define FTRACE_ON           1       // hooks record
+#define FTRACE_DONE         2       // flushed, hooks do nothing
+
+typedef struct ftrace_rec_s {
+    unsigned long   fn;             // function address | FTRACE_EXIT
+    unsigned long   delta;          // cycles since previous record
+} ftrace_rec_t;
+
+typedef struct ftrace_ring_s {
+    unsigned long   state;          // FTRACE_OFF/ON/DONE
+    unsigned long   num;            // records written (ring index)
+    unsigned long   last;           // cycle of previous record
+    ftrace_rec_t    rec[FTRACE_RING_NUM];
+} ftrace_ring_t;
+
+extern ftrace_ring_t ftrace_ring;
+
+void __cyg_profile_func_enter ( void *fn, void *site ) __attribute__((no_instrument_function));
+void __cyg_profile_func_exit  ( void *fn, void *site ) __attribute__((no_instrument_function));
+void ftrace_flush             ( void )                 __attribute__((no_instrument_function));
@@ -0,0 +1,385 @@
+/// @file   imsic.c
+/// @brief  RISC-V Shared Library - IMSIC interrupt file driver (bulk enable,
+///         pending, priority, profiles), guest interrupt files and VS-mode
+///         external interrupt routing
+
+#include "arch.h"
+#include "imsic.h"
+
+
+/* Interrupt file register access, {m|s|vs}iselect/{m|s|vs}ireg pair 
+   selected by level. EIE/EIP/IPRIO indices are the same for all levels */
+
+enum imsic_op_e {
+    IMSIC_OP_READ   = 0,
+    IMSIC_OP_WRITE  = 1,
+    IMSIC_OP_SET    = 2,
+    IMSIC_OP_CLEAR  = 3,
+};
+
+#define IMSIC_IREG_OP(__sel__, __reg__)                         \
+    __csrw( __sel__, isel );                                    \
+    switch (op) {                                               \
+        case IMSIC_OP_READ:  __csrr( val, __reg__ );    break;  \
+        case IMSIC_OP_WRITE: __csrw( __reg__, val );    break;  \
+        case IMSIC_OP_SET:   __csrs( __reg__, val );    break;  \
+        case IMSIC_OP_CLEAR: __csrc( __reg__, val );    break;  \
+    }                                                           \
+    break;
+
+static imsic_profile_t imsic_profile[IMSIC_PROFILE_MAX];
+
+
+/// @name   imsic_ireg( level, op, isel, val )
+/// @brief  read/write/set/clear interrupt file register, returns read value
+static unsigned long imsic_ireg(int level, int op, unsigned long isel, unsigned long val) {
+
+    switch (level) {
+        case IMSIC_LEVEL_M:     IMSIC_IREG_OP( CSR_MISELECT,  CSR_MIREG  )
+        case IMSIC_LEVEL_S:     IMSIC_IREG_OP( CSR_SISELECT,  CSR_SIREG  )
+        case IMSIC_LEVEL_VS:    IMSIC_IREG_OP( CSR_VSISELECT, CSR_VSIREG )
+    }
+
+    return val;
+}
+
+
+/// @name   imsic_ext_enable_map( level, first, num, *map )
+/// @brief  write num eie registers starting from eie[first], 
+///         one register write per 32 EIIDs
+ret_t imsic_ext_enable_map(int level, int first, int num, const unsigned long *map) {
+
+    for (int i = 0; i < num; i++)
+        imsic_ireg( level, IMSIC_OP_WRITE, M_EI_ENABLE_REG(first + i), map[i] );
+
+    return (ret_t){ 0, num };
+}
+
+
+/// @name   imsic_ext_enable_range( level, eiid, num, enable )
+/// @brief  enable/disable num EIIDs starting from eiid, 
+///         one csrs/csrc per 32 EIIDs, returns number of writes in a1
+ret_t imsic_ext_enable_range(int level, unsigned long eiid, unsigned long num, int enable) {
+
+    unsigned long end = eiid + num, writes = 0, cnt, mask;
+
+    while (eiid < end) {
+
+        cnt  = 32 - (eiid & 0x1F);
+        cnt  = (cnt < end - eiid) ? cnt : end - eiid;
+        mask = ((cnt < 32) ? ((1UL << cnt) - 1) : ~0UL) << (eiid & 0x1F);
+
+        imsic_ireg( level, (enable) ? IMSIC_OP_SET : IMSIC_OP_CLEAR, M_EI_ENABLE_REG(eiid >> 5), mask );
+
+        writes++;
+        eiid += cnt;
+    }
+
+    return (ret_t){ 0, writes };
+}
+
+
+/// @name   imsic_ext_pending_map( level, first, num, *map )
+/// @brief  read num eip registers starting from eip[first]
+ret_t imsic_ext_pending_map(int level, int first, int num, unsigned long *map) {
+
+    for (int i = 0; i < num; i++)
+        map[i] = imsic_ireg( level, IMSIC_OP_READ, M_EI_PENDING_REG(first + i), 0 );
+
+    return (ret_t){ 0, num };
+}
+
+
+/// @name   imsic_ext_pending_set( level, first, num, *map, set )
+/// @brief  set/clear pending bits of map in num eip registers starting 
+///         from eip[first], registers with empty map word are not accessed
+ret_t imsic_ext_pending_set(int level, int first, int num, const unsigned long *map, int set) {
+
+    unsigned long writes = 0;
+
+    for (int i = 0; i < num; i++) {
+        if ( 0 == map[i] )
+            continue;
+        imsic_ireg( level, (set) ? IMSIC_OP_SET : IMSIC_OP_CLEAR, M_EI_PENDING_REG(first + i), map[i] );
+        writes++;
+    }
+
+    return (ret_t){ 0, writes };
+}
+
+
+/// @name   imsic_maj_priority_map( level, iid, num, *prio )
+/// @brief  set priorities of num major interrupts starting from iid, 
+///         whole iprio register is written for 4 IIDs, partially covered 
+///         registers are read-modify-write. M and S levels only
+ret_t imsic_maj_priority_map(int level, unsigned long iid, unsigned long num, const unsigned char *prio) {
+
+    unsigned long end = iid + num, writes = 0, val, n;
+
+    if ( IMSIC_LEVEL_VS == level )
+        return (ret_t){ -1, 0 };
+
+    for (unsigned long reg = iid >> 2; (reg << 2) < end; reg++) {
+
+        val = 0;
+
+        if ( ((reg << 2) < iid) || (((reg << 2) + 4) > end) )
+            val = imsic_ireg( level, IMSIC_OP_READ, IMSIC_IPRIO_REG(reg << 2), 0 );
+
+        for (int b = 0; b < 4; b++) {
+            n = (reg << 2) + b;
+            if ( (n < iid) || (n >= end) )
+                continue;
+            val &= ~(0xFFUL << (b * 8));
+            val |= (unsigned long)prio[n - iid] << (b * 8);
+        }
+
+        imsic_ireg( level, IMSIC_OP_WRITE, IMSIC_IPRIO_REG(reg << 2), val );
+        writes++;
+    }
+
+    return (ret_t){ 0, writes };
+}
+
+
+/// @name   imsic_profile_find( *name )
+/// @brief  find named profile, 0 if not found
+static imsic_profile_t *imsic_profile_find(const char *name) {
+
+    const char *a, *b;
+
+    for (int i = 0; i < IMSIC_PROFILE_MAX; i++) {
+        if ( 0 == imsic_profile[i].name )
+            continue;
+        for (a = imsic_profile[i].name, b = name; *a && (*a == *b); a++, b++)
+            ;
+        if ( *a == *b )
+            return &imsic_profile[i];
+    }
+
+    return 0;
+}
+
+
+/// @name   imsic_profile_save( *name, level )
+/// @brief  snapshot interrupt file configuration of the level as named 
+///         profile, profile with the same name is overwritten
+ret_t imsic_profile_save(const char *name, int level) {
+
+    imsic_profile_t *p = imsic_profile_find(name);
+
+    for (int i = 0; (0 == p) && (i < IMSIC_PROFILE_MAX); i++)
+        if ( 0 == imsic_profile[i].name )
+            p = &imsic_profile[i];
+
+    if ( 0 == p )
+        return (ret_t){ -1, 0 };            // no free profile slot
+
+    p->name      = name;
+    p->level     = level;
+    p->delivery  = imsic_ireg( level, IMSIC_OP_READ, M_EI_DELIVERY_REG, 0 );
+    p->threshold = imsic_ireg( level, IMSIC_OP_READ, M_EI_THRESHOLD_REG, 0 );
+
+    for (int i = 0; i < IMSIC_MAP_NUM; i++)
+        p->enable[i] = imsic_ireg( level, IMSIC_OP_READ, M_EI_ENABLE_REG(i), 0 );
+
+    for (int i = 0; i < IMSIC_IPRIO_NUM; i++)
+        p->iprio[i] = ( IMSIC_LEVEL_VS == level ) ? 0 : imsic_ireg( level, IMSIC_OP_READ, IMSIC_IPRIO_REG(i << 2), 0 );
+
+    return (ret_t){ 0, p - imsic_profile };
+}
+
+
+/// @name   imsic_profile_restore( *name )
+/// @brief  restore interrupt file configuration from named profile, 
+///         delivery is disabled while registers are rewritten.
+///         Returns number of register writes in a1
+ret_t imsic_profile_restore(const char *name) {
+
+    imsic_profile_t *p = imsic_profile_find(name);
+    unsigned long writes = 0;
+
+    if ( 0 == p )
+        return (ret_t){ -1, 0 };
+
+    imsic_ireg( p->level, IMSIC_OP_WRITE, M_EI_DELIVERY_REG, 0 );
+
+    writes += imsic_ext_enable_map( p->level, 0, IMSIC_MAP_NUM, p->enable ).a1;
+
+    for (int i = 0; (IMSIC_LEVEL_VS != p->level) && (i < IMSIC_IPRIO_NUM); i++) {
+        imsic_ireg( p->level, IMSIC_OP_WRITE, IMSIC_IPRIO_REG(i << 2), p->iprio[i] );
+        writes++;
+    }
+
+    imsic_ireg( p->level, IMSIC_OP_WRITE, M_EI_THRESHOLD_REG, p->threshold );
+    imsic_ireg( p->level, IMSIC_OP_WRITE, M_EI_DELIVERY_REG, p->delivery );
+
+    return (ret_t){ 0, writes + 3 };
+}
+
+
+/// @name   imsic_guest_valid( gfile )
+/// @brief  check if guest interrupt file is implemented (hgeie bit is writable,
+///         probed once, see tmon_gfile_mask())
+static int imsic_guest_valid(unsigned long gfile) {
+
+    return tmon_gfile_valid(gfile);
+}
+
+
+/// @name   imsic_guest_select( gfile )
+/// @brief  select guest interrupt file for vsiselect/vsireg access,
+///         returns previous hstatus value
+static unsigned long imsic_guest_select(unsigned long gfile) {
+
+    unsigned long hstatus;
+
+    __csrr( hstatus, CSR_HSTATUS );
+    __csrw( CSR_HSTATUS, (hstatus & ~CSR_HSTATUS_VGEIN_MASK) | (gfile << CSR_HSTATUS_VGEIN_SHIFT) );
+
+    return hstatus;
+}
+
+
+/// @name   imsic_guest_num()
+/// @brief  number of implemented guest interrupt files (GEILEN) in a0,
+///         mask of implemented guest files (writable hgeie bits) in a1,
+///         hgeie is probed by the first call only
+ret_t imsic_guest_num(void) {
+
+    unsigned long mask = tmon_gfile_mask(), num = 0;
+
+    for (unsigned long m = mask; m; m &= m - 1)
+        num++;
+
+    return (ret_t){ num, mask };
+}
+
+
+/// @name   imsic_guest_assign( gfile )
+/// @brief  assign guest interrupt file to the running VS partition
+///         (hstatus.VGEIN), 0 - no guest file (software injection only)
+ret_t imsic_guest_assign(unsigned long gfile) {
+
+    if ( (0 != gfile) && !imsic_guest_valid(gfile) )
+        return (ret_t){ -1, 0 };
+
+    imsic_guest_select(gfile);
+
+    return (ret_t){ 0, 0 };
+}
+
+
+/// @name   imsic_guest_delivery( gfile, enable )
+/// @brief  enable/disable interrupt delivery of guest interrupt file (eidelivery)
+ret_t imsic_guest_delivery(unsigned long gfile, int enable) {
+
+    unsigned long hstatus;
+
+    if ( !imsic_guest_valid(gfile) )
+        return (ret_t){ -1, 0 };
+
+    hstatus = imsic_guest_select(gfile);
+
+    __csrw( CSR_VSISELECT, S_EI_DELIVERY_REG );
+    __csrw( CSR_VSIREG, (enable) ? 1 : 0 );
+
+    __csrw( CSR_HSTATUS, hstatus );
+
+    return (ret_t){ 0, 0 };
+}
+
+
+/// @name   imsic_guest_threshold( gfile, threshold )
+/// @brief  set priority threshold of guest interrupt file (eithreshold)
+ret_t imsic_guest_threshold(unsigned long gfile, unsigned long threshold) {
+
+    unsigned long hstatus;
+
+    if ( !imsic_guest_valid(gfile) )
+        return (ret_t){ -1, 0 };
+
+    hstatus = imsic_guest_select(gfile);
+
+    __csrw( CSR_VSISELECT, S_EI_THRESHOLD_REG );
+    __csrw( CSR_VSIREG, threshold );
+
+    __csrw( CSR_HSTATUS, hstatus );
+
+    return (ret_t){ 0, 0 };
+}
+
+
+/// @name   imsic_guest_enable( gfile, eiid, enable )
+/// @brief  enable/disable interrupt identity of guest interrupt file (eieN)
+ret_t imsic_guest_enable(unsigned long gfile, unsigned long eiid, int enable) {
+
+    unsigned long hstatus;
+
+    if ( !imsic_guest_valid(gfile) )
+        return (ret_t){ -1, 0 };
+
+    hstatus = imsic_guest_select(gfile);
+
+    __csrw( CSR_VSISELECT, S_EI_ENABLE_REG(eiid >> 5) );
+    if (enable)
+        __csrs( CSR_VSIREG, 1 << (eiid & 0x1F) );
+    else
+        __csrc( CSR_VSIREG, 1 << (eiid & 0x1F) );
+
+    __csrw( CSR_HSTATUS, hstatus );
+
+    return (ret_t){ 0, 0 };
+}
+
+
+/// @name   imsic_guest_send( gfile, eiid )
+/// @brief  send MSI to guest interrupt file (HS-mode MMIO write,
+///         see TMON_FID_GMSI for requests from lower privilege levels)
+ret_t imsic_guest_send(unsigned long gfile, unsigned long eiid) {
+
+    if ( !imsic_guest_valid(gfile) )
+        return (ret_t){ -1, 0 };
+
+    __smsi_base[gfile * (IMSIC_GUEST_IFILE_STRIDE / sizeof(long))] = eiid;
+
+    return (ret_t){ 0, 0 };
+}
+
+
+/// @name   imsic_guest_wakeup( gfile, enable )
+/// @brief  enable/disable guest external interrupt (SGEI) to HS-mode for
+///         guest interrupt file of not running guest (hgeie, hie.SGEIE)
+ret_t imsic_guest_wakeup(unsigned long gfile, int enable) {
+
+    unsigned long hgeie;
+
+    if ( !imsic_guest_valid(gfile) )
+        return (ret_t){ -1, 0 };
+
+    if (enable)
+        __csrs( CSR_HGEIE, 1 << gfile );
+    else
+        __csrc( CSR_HGEIE, 1 << gfile );
+
+    __csrr( hgeie, CSR_HGEIE );
+
+    if (hgeie)
+        __csrs( CSR_HIE, 1 << CSR_HIE_GEIE_BIT );
+    else
+        __csrc( CSR_HIE, 1 << CSR_HIE_GEIE_BIT );
+
+    return (ret_t){ 0, hgeie };
+}
+
+
+/// @name   imsic_guest_pending()
+/// @brief  guest interrupt files with pending and enabled interrupts (hgeip) in a1
+ret_t imsic_guest_pending(void) {
+
+    unsigned long hgeip;
+
+    __csrr( hgeip, CSR_HGEIP );
+
+    return (ret_t){ 0, hgeip };
+}
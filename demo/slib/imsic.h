@@ -0,0 +1,85 @@
+/// @file   imsic.h
+/// @brief  RISC-V Shared Library - IMSIC interrupt file driver (bulk enable,
+///         pending, priority, profiles), guest interrupt files and VS-mode
+///         external interrupt routing, header file
+
+
+#pragma once
+
+#include "tmon.h"
+
+/*
+    IMSIC interrupt file driver:
+
+    - interrupt file is selected by level: M (miselect/mireg), S (siselect/
+      sireg, S-level file in HS-mode, guest file in VS-mode) or VS (vsiselect/
+      vsireg, guest file selected by hstatus.VGEIN, HS-mode only)
+    - eie/eip registers are accessed 32 EIIDs at a time, map[i] bit n is
+      EIID (first + i) * 32 + n
+    - major interrupt priorities (iprio) are written 4 IIDs at a time, 
+      they are implemented for M and S levels only
+    - profile is a named snapshot of interrupt file configuration (delivery,
+      threshold, eie, iprio), restore writes whole registers only 
+*/
+
+#ifndef IMSIC_EIID_NUM
+#define IMSIC_EIID_NUM      256     // EIIDs covered by profiles
+#endif
+
+#define IMSIC_MAP_NUM       (IMSIC_EIID_NUM / 32)   // eie/eip registers in profile
+#define IMSIC_IPRIO_NUM     16                      // iprio0..iprio15 registers
+#define IMSIC_PROFILE_MAX   4                       // named profiles
+
+enum imsic_level_e {
+    IMSIC_LEVEL_M   = 0,
+    IMSIC_LEVEL_S   = 1,
+    IMSIC_LEVEL_VS  = 2,
+};
+
+typedef struct imsic_profile_s {
+    const char     *name;                       // 0 - free slot
+    unsigned long   level;
+    unsigned long   delivery;                   // eidelivery
+    unsigned long   threshold;                  // eithreshold
+    unsigned long   enable[IMSIC_MAP_NUM];      // eie0..
+    unsigned long   iprio[IMSIC_IPRIO_NUM];     // iprio0..15 (M/S levels)
+} imsic_profile_t;
+
+
+/* Interrupt file API */
+
+ret_t imsic_ext_enable_map  ( int level, int first, int num, const unsigned long *map );
+ret_t imsic_ext_enable_range( int level, unsigned long eiid, unsigned long num, int enable );
+ret_t imsic_ext_pending_map ( int level, int first, int num, unsigned long *map );
+ret_t imsic_ext_pending_set ( int level, int first, int num, const unsigned long *map, int set );
+ret_t imsic_maj_priority_map( int level, unsigned long iid, unsigned long num, const unsigned char *prio );
+
+ret_t imsic_profile_save    ( const char *name, int level );
+ret_t imsic_profile_restore ( const char *name );
+
+/*
+    IMSIC guest interrupt files:
+
+    - guest interrupt file #g (1..GEILEN) follows S-level interrupt file
+      in the MSI address space (IMSIC_GUEST_IFILE_STRIDE apart)
+    - hstatus.VGEIN selects the guest file of the running VS partition,
+      its interrupts are delivered directly as VS external interrupts
+      (hideleg.VSEI), VS-mode claims them with stopei (vstopei)
+    - interrupts of not running guests are reported to HS-mode as guest
+      external interrupts (hgeip & hgeie, hie.SGEIE)
+    - guest file registers are accessed by HS-mode with vsiselect/vsireg,
+      hstatus.VGEIN is switched temporarily to the specified guest file
+    - VGEIN of multiple guests is switched with VS-mode context (vctx.c)
+*/
+
+
+/* HS-mode guest interrupt file API */
+
+ret_t imsic_guest_num       ( void );
+ret_t imsic_guest_assign    ( unsigned long gfile );
+ret_t imsic_guest_delivery  ( unsigned long gfile, int enable );
+ret_t imsic_guest_threshold ( unsigned long gfile, unsigned long threshold );
+ret_t imsic_guest_enable    ( unsigned long gfile, unsigned long eiid, int enable );
+ret_t imsic_guest_send      ( unsigned long gfile, unsigned long eiid );
+ret_t imsic_guest_wakeup    ( unsigned long gfile, int enable );
+ret_t imsic_guest_pending   ( void );
@@ -0,0 +1,123 @@
+/// @file   mpool.c
+/// @brief  RISC-V Shared Library - protection-aligned memory pools, one
+///         SMPU/HMPU region or SPMP NAPOT entry per block, any privilege level
+
+#include "arch.h"
+#include "spmp.h"
+#include "mpool.h"
+
+
+/// @name   mpool_size( kind, size )
+/// @brief  size covered by one region/entry: 32-byte multiple (SMPU) or
+///         power of 2 (SPMP)
+/// @return protection-aligned size, 0 - size is not representable
+unsigned long mpool_size(mpool_kind_t kind, unsigned long size) {
+
+    register unsigned long p2 = MPOOL_SPMP_GRAIN;
+
+    if ( 0 == size )
+        size = 1;
+
+    if ( MPOOL_SMPU == kind )
+        return ( size > ~0UL - (MPOOL_SMPU_GRAIN - 1) ) ? 0 : ALLOC_ROUND(size, MPOOL_SMPU_GRAIN);
+
+    while ( p2 < size && p2 )
+        p2 <<= 1;
+
+    return p2;
+}
+
+
+/// @name   mpool_region( kind, *base, size, attr, *r )
+/// @brief  region descriptor of protection-aligned block [base, base + size)
+/// @return 0 - OK, -1 - block is not aligned to the protection granularity
+ret_t mpool_region(mpool_kind_t kind, void *base, unsigned long size, unsigned long attr, mpool_region_t *r) {
+
+    register unsigned long b = (unsigned long)base;
+
+    if ( size != mpool_size(kind, size) || (b & (((MPOOL_SMPU == kind) ? MPOOL_SMPU_GRAIN : size) - 1)) ) {
+        ERROR("block 0x%lx of %lu bytes is not protection-aligned\n", b, size);
+        return (ret_t){ -1, 0 };
+    }
+
+    r->base = b;
+    r->size = size;
+
+    if ( MPOOL_SMPU == kind ) {
+        r->entry[0] = b;
+        r->entry[1] = (size - MPOOL_SMPU_GRAIN) + attr;
+    } else {
+        r->entry[0] = b | ((size >> 1) - 1);    // (b >> 2) | (size / 8 - 1) when shifted
+        r->entry[1] = SPMP_RANGE_NAPOT | attr;
+    }
+
+    return (ret_t){ 0, size };
+}
+
+
+/// @name   mpool_alloc_region( *a, kind, size, attr, *r )
+/// @brief  carve protection-aligned block from arena, descriptor to r
+/// @return block address, 0 - arena is exhausted
+void *mpool_alloc_region(arena_t *a, mpool_kind_t kind, unsigned long size, unsigned long attr, mpool_region_t *r) {
+
+    register unsigned long psize = mpool_size(kind, size);
+    register void         *blk;
+
+    if ( 0 == psize ) {
+        a->fails++;
+        return 0;
+    }
+
+    blk = arena_alloc(a, psize, (MPOOL_SMPU == kind) ? MPOOL_SMPU_GRAIN : psize);
+
+    if ( blk )
+        mpool_region(kind, blk, psize, attr, r);
+
+    return blk;
+}
+
+
+/// @name   mpool_create( *mp, *a, kind, block, num, attr )
+/// @brief  pool of num protection-aligned blocks carved from arena, block
+///         is rounded up to the protection granularity
+ret_t mpool_create(mpool_t *mp, arena_t *a, mpool_kind_t kind, unsigned long block, unsigned long num, unsigned long attr) {
+
+    register unsigned long psize = mpool_size(kind, block);
+    register void         *mem   = 0;
+
+    mp->kind = kind;
+    mp->attr = attr;
+
+    if ( psize && num && psize <= ~0UL / num )
+        mem = arena_alloc(a, psize * num, (MPOOL_SMPU == kind) ? MPOOL_SMPU_GRAIN : psize);
+
+    if ( 0 == mem ) {
+        mp->pool = (pool_t){};
+        return (ret_t){ -1, 0 };
+    }
+
+    return pool_init(&mp->pool, mem, psize, num);
+}
+
+
+/// @name   mpool_alloc( *mp, *r )
+/// @brief  take block from pool, its region descriptor to r
+/// @return block address, 0 - pool is empty
+void *mpool_alloc(mpool_t *mp, mpool_region_t *r) {
+
+    register void *blk = pool_alloc(&mp->pool);
+
+    if ( blk )
+        mpool_region(mp->kind, blk, mp->pool.block, mp->attr, r);
+
+    return blk;
+}
+
+
+/// @name   mpool_free( *mp, *blk )
+/// @brief  return block to pool, region/entry covering it is left to the
+///         caller to disable
+ret_t mpool_free(mpool_t *mp, void *blk) {
+
+    return pool_free(&mp->pool, blk);
+}
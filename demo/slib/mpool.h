@@ -0,0 +1,63 @@
+/// @file   mpool.h
+/// @brief  RISC-V Shared Library - protection-aligned memory pools, one
+///         SMPU/HMPU region or SPMP NAPOT entry per block, header file
+
+
+#pragma once
+
+#include "tmon.h"
+#include "alloc.h"
+
+/*
+    Blocks are sized and aligned to the protection unit granularity, so
+    each protected object is covered by exactly one region/entry:
+
+    MPOOL_SMPU  - size is rounded up to 32 bytes, base is 32-byte aligned,
+                  region entry is { base, (size - 32) + attr } (SMPU and
+                  HMPU, attr is SMPU_ATTR_* or HMPU_ATTR_*)
+    MPOOL_SPMP  - size is rounded up to power of 2 (8 bytes min), base is
+                  aligned to size, entry is { NAPOT address, NAPOT | attr }
+                  (attr is SPMP_ATTR_*), address is byte address as taken
+                  by spmp_set_entry()
+
+    mpool_alloc_region() carves a single block from an arena, mpool_t is
+    a fixed-size block pool (alloc.c pool_t) whose every block is such a
+    block. The region descriptor is ready to apply:
+
+        smpu_region_config(id, r.entry)      - SMPU
+        l2[i][0] = r.entry[0], l2[i][1] = r.entry[1]   - HMPU/vctx
+        spmp_set_entry(&cfg, i, r.entry[0], r.entry[1]) - SPMP
+
+    SPMP power-of-2 rounding may waste up to half of the block, arena
+    padding for alignment is reported by arena statistics.
+*/
+
+#define MPOOL_SMPU_GRAIN    32
+#define MPOOL_SPMP_GRAIN    8
+
+typedef enum {
+    MPOOL_SMPU          = 0,        // SMPU/HMPU region, 32-byte granularity
+    MPOOL_SPMP          = 1,        // SPMP NAPOT entry
+} mpool_kind_t;
+
+typedef struct mpool_region_s {
+    unsigned long   base;           // [base, base + size)
+    unsigned long   size;
+    unsigned long   entry[2];       // ready-to-apply region/entry descriptor
+} mpool_region_t;
+
+typedef struct mpool_s {
+    pool_t          pool;           // block is protection-aligned size
+    mpool_kind_t    kind;
+    unsigned long   attr;
+} mpool_t;
+
+unsigned long mpool_size        ( mpool_kind_t kind, unsigned long size );
+ret_t         mpool_region      ( mpool_kind_t kind, void *base, unsigned long size, unsigned long attr, mpool_region_t *r );
+void         *mpool_alloc_region( arena_t *a, mpool_kind_t kind, unsigned long size, unsigned long attr, mpool_region_t *r );
+
+ret_t         mpool_create      ( mpool_t *mp, arena_t *a, mpool_kind_t kind, unsigned long block, unsigned long num, unsigned long attr );
+void         *mpool_alloc       ( mpool_t *mp, mpool_region_t *r );
+ret_t         mpool_free        ( mpool_t *mp, void *blk );
+
+#define mpool_report(__mp__, __name__)  pool_report(&(__mp__)->pool, __name__)
@@ -6,7 +6,13 @@
 
 	// first arg is the test number, fix it to zero for compatibility with exit()
 	extern int __attribute__((noreturn)) _semihost_halt(int arg1, int arg2);
+#ifdef FTRACE
+	// function trace ring is flushed before halt (FTRACE=1 build mode)
+	extern void ftrace_flush(void);
+	#define exit(__status__)    (ftrace_flush(), _semihost_halt(0, __status__))
+#else
 	#define exit(__status__)    _semihost_halt(0, __status__)
+#endif
 
 	extern int _semihost_writec(int arg);
 	#define putchar(__ch__)     _semihost_writec((int)(__ch__))
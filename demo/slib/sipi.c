@@ -0,0 +1,84 @@
+/// @file   sipi.c
+/// @brief  RISC-V Shared Library - S-level self-IPI and MSI sending without
+///         monitor calls, S/U-mode code
+
+#include "arch.h"
+#include "smpu.h"
+#include "sipi.h"
+
+
+/// @name   sipi_smpu_map( id, umode )
+/// @brief  configure and enable SMPU regions id (SSWI page) and id + 1
+///         (S-level IMSIC file), S-mode only or shared S/U-mode read-write
+ret_t sipi_smpu_map(int id, int umode) {
+
+    unsigned long attr = (umode) ? SMPU_ATTR_SRW : SMPU_ATTR_RW;
+
+    const unsigned long entries[2][2] = {
+        { (unsigned long)__mmio_base + SIPI_SSWI_OFFSET, SIPI_PAGE_SIZE - 32 + attr },
+        { (unsigned long)__smsi_base,                    SIPI_PAGE_SIZE - 32 + attr },
+    };
+
+    smpu_group_config(id, 2, entries);
+    smpu_group_enable(1, 3 << id);
+
+    return (ret_t){ 0, 3 << id };
+}
+
+
+/// @name   sipi_spmp_map( *config, index, umode )
+/// @brief  set NAPOT entries index (SSWI page) and index + 1 (S-level IMSIC
+///         file) in the shadow configuration, S-mode only or shared S/U-mode
+///         read-write. Entries are switched on with spmp_set_switch() and
+///         spmp_config_apply() by the caller
+ret_t sipi_spmp_map(spmp_cfg_t *config, unsigned long index, int umode) {
+
+    unsigned long attr = SPMP_RANGE_NAPOT | ((umode) ? SPMP_ATTR_WX : SPMP_ATTR_SRW);
+    unsigned long sswi = (unsigned long)__mmio_base + SIPI_SSWI_OFFSET;
+    unsigned long smsi = (unsigned long)__smsi_base;
+
+    spmp_set_entry(config, index + 0, NAPOT(sswi, 12), attr);
+    spmp_set_entry(config, index + 1, NAPOT(smsi, 12), attr);
+
+    return (ret_t){ 0, 3 << index };
+}
+
+
+/// @name   sipi_sswi( enable )
+/// @brief  assert/de-assert S-mode software interrupt, direct write
+ret_t sipi_sswi(int enable) {
+
+    SIPI_SSWI = (enable) ? 1 : 0;
+
+    return (ret_t){ 0, 0 };
+}
+
+
+/// @name   sipi_smsi( eiid )
+/// @brief  send MSI to S-level IMSIC file, direct write
+ret_t sipi_smsi(unsigned long eiid) {
+
+    SIPI_SMSI = eiid;
+
+    return (ret_t){ 0, eiid };
+}
+
+
+/// @name   sipi_mswi( enable )
+/// @brief  assert/de-assert M-mode software interrupt, monitor request
+ret_t sipi_mswi(int enable) {
+
+    tmon_call(TMON_FID_MSWI, enable);
+
+    return (ret_t){ 0, 0 };
+}
+
+
+/// @name   sipi_mmsi( eiid )
+/// @brief  send MSI to M-level IMSIC file, monitor request
+ret_t sipi_mmsi(unsigned long eiid) {
+
+    tmon_call(TMON_FID_MMSI, eiid);
+
+    return (ret_t){ 0, eiid };
+}
@@ -0,0 +1,41 @@
+/// @file   sipi.h
+/// @brief  RISC-V Shared Library - S-level self-IPI and MSI sending without
+///         monitor calls, S/U-mode code, header file
+
+
+#pragma once
+
+#include "tmon.h"
+#include "spmp.h"
+
+/*
+    S-level interrupt sources are ordinary MMIO pages:
+
+    - SSWI register of hart 0 (ACLINT SSWI, __mmio_base + 0xC000)
+    - S-level IMSIC interrupt file of hart 0 (__smsi_base)
+
+    sipi_smpu_map()/sipi_spmp_map() add both pages to the S-mode memory
+    map (S-mode only or shared S/U-mode), then sipi_sswi()/sipi_smsi()
+    write them directly from S/U-mode. M-level targets (MSWI, M-level IMSIC
+    file) are not mapped and are sent with monitor requests.
+*/
+
+#define SIPI_SSWI_OFFSET    0xC000  // SSWI register offset in MMIO region
+#define SIPI_PAGE_SIZE      0x1000
+
+/* direct S-level sending (mapped pages) */
+
+#define SIPI_SSWI           (__mmio_base[SIPI_SSWI_OFFSET / sizeof(long)])
+#define SIPI_SMSI           (__smsi_base[0])
+
+/* S-mode memory map */
+
+ret_t sipi_smpu_map ( int id, int umode );
+ret_t sipi_spmp_map ( spmp_cfg_t *config, unsigned long index, int umode );
+
+/* S-level (direct) and M-level (monitor) interrupt sending */
+
+ret_t sipi_sswi     ( int enable );
+ret_t sipi_smsi     ( unsigned long eiid );
+ret_t sipi_mswi     ( int enable );
+ret_t sipi_mmsi     ( unsigned long eiid );
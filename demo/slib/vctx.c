@@ -0,0 +1,173 @@
+/// @file   vctx.c 
+/// @brief  RISC-V Shared Library - VS-mode guest context (world) switch,
+///         HS-mode code
+
+#include "arch.h"
+#include "vctx.h"
+
+
+/* VS-mode CSRs of guest context (VCTX_CSR_NUM entries) */
+
+#define VCTX_CSR_LIST(X)        \
+    X(0, CSR_VSSTATUS)          \
+    X(1, CSR_VSIE)              \
+    X(2, CSR_VSTVEC)            \
+    X(3, CSR_VSSCRATCH)         \
+    X(4, CSR_VSEPC)             \
+    X(5, CSR_VSCAUSE)           \
+    X(6, CSR_VSTVAL)            \
+    X(7, CSR_VSATP)             \
+    X(8, CSR_HVIP)
+
+
+/// @name   vctx_save( *ctx )
+/// @brief  save guest-modifiable state of the current guest, L2 MPU is 
+///         owned by HS-mode and is not saved
+static void vctx_save(vctx_t *ctx) {
+
+#define VCTX_CSR_SAVE(__i__, __csr__)   __csrr( ctx->csr[__i__], __csr__ );
+    VCTX_CSR_LIST(VCTX_CSR_SAVE)
+#undef VCTX_CSR_SAVE
+
+    if ( 0 != ctx->vmpu )
+        return;                     // L1 is emulated, shadow is up to date
+
+    __csrr( ctx->l1_mask, CSR_VSMPUMASK );
+
+    for (int id = 0; id < 32; id++) {
+        __csrw( CSR_VSISELECT, ICSR_SMPU_BASE + (id << 1) + 0 );
+        __csrr( ctx->l1[id][0], CSR_VSIREG );
+        __csrw( CSR_VSISELECT, ICSR_SMPU_BASE + (id << 1) + 1 );
+        __csrr( ctx->l1[id][1], CSR_VSIREG );
+    }
+}
+
+
+/// @name   vctx_restore( *prev, *next )
+/// @brief  load state of the next guest, registers equal to the previous 
+///         guest ones are not written (all registers if prev is 0).
+///         Returns number of written registers
+static unsigned long vctx_restore(vctx_t *prev, vctx_t *next) {
+
+    unsigned long writes = 0, val;
+
+#define VCTX_CSR_RESTORE(__i__, __csr__)                        \
+    if ( !prev || (prev->csr[__i__] != next->csr[__i__]) ) {    \
+        __csrw( __csr__, next->csr[__i__] );                    \
+        writes++;                                               \
+    }
+    VCTX_CSR_LIST(VCTX_CSR_RESTORE)
+#undef VCTX_CSR_RESTORE
+
+    if ( !prev || (prev->hstatus != next->hstatus) ) {
+        __csrr( val, CSR_HSTATUS );
+        __csrw( CSR_HSTATUS, (val & ~CSR_HSTATUS_VGEIN_MASK) | (next->hstatus & CSR_HSTATUS_VGEIN_MASK) );
+        writes++;
+    }
+
+    /* L1 emulation (vmpu.c) owns L2 MPU, effective L2 configuration is 
+       the guest L1 shadow combined with host L2 regions */
+
+    if ( 0 != next->vmpu ) {
+        if ( !prev || !prev->vmpu )
+            vmpu_guest_switch( 0 );         // L2 was programmed here, cache is stale
+        vmpu_guest_switch( next->vmpu );
+        return writes;
+    }
+
+    if ( !prev || prev->vmpu )
+        vmpu_guest_switch( 0 );             // hardware L1, CSRIND is restored
+
+    /* L2 MPU (HS-mode), MPU regions apply to VS/VU-mode accesses only,
+       so they are reprogrammed without disabling */
+
+    for (int id = 0; id < 32; id++) {
+        if ( prev && !prev->vmpu && (prev->l2[id][0] == next->l2[id][0]) && (prev->l2[id][1] == next->l2[id][1]) )
+            continue;
+        __icsrw( ICSR_HMPU_BASE + (id << 1) + 0, next->l2[id][0] );
+        __icsrw( ICSR_HMPU_BASE + (id << 1) + 1, next->l2[id][1] );
+        writes += 2;
+    }
+
+    if ( !prev || prev->vmpu || (prev->l2_mask != next->l2_mask) ) {
+        __csrw( CSR_HMPUMASK, next->l2_mask );
+        writes++;
+    }
+
+    /* L1 MPU (VS-mode) */
+
+    for (int id = 0; id < 32; id++) {
+        if ( prev && !prev->vmpu && (prev->l1[id][0] == next->l1[id][0]) && (prev->l1[id][1] == next->l1[id][1]) )
+            continue;
+        __csrw( CSR_VSISELECT, ICSR_SMPU_BASE + (id << 1) + 0 );
+        __csrw( CSR_VSIREG, next->l1[id][0] );
+        __csrw( CSR_VSISELECT, ICSR_SMPU_BASE + (id << 1) + 1 );
+        __csrw( CSR_VSIREG, next->l1[id][1] );
+        writes += 2;
+    }
+
+    if ( !prev || prev->vmpu || (prev->l1_mask != next->l1_mask) ) {
+        __csrw( CSR_VSMPUMASK, next->l1_mask );
+        writes++;
+    }
+
+    return writes;
+}
+
+
+/// @name   vctx_init( *ctx, *vmpu )
+/// @brief  initialize guest context: VS-mode CSRs are reset, L1/L2 MPU 
+///         regions are disabled. vmpu - L1 emulation shadow or 0 
+ret_t vctx_init(vctx_t *ctx, vmpu_guest_t *vmpu) {
+
+    for (int i = 0; i < VCTX_CSR_NUM; i++)
+        ctx->csr[i] = 0;
+
+    for (int id = 0; id < 32; id++) {
+        ctx->l1[id][0] = ctx->l1[id][1] = 0;
+        ctx->l2[id][0] = ctx->l2[id][1] = 0;
+    }
+
+    ctx->hstatus = 0;
+    ctx->l1_mask = 0;
+    ctx->l2_mask = 0;
+    ctx->vmpu    = vmpu;
+
+    return (ret_t){ 0, 0 };
+}
+
+
+/// @name   vctx_l2_config( *ctx, start_id, num, entries, mask )
+/// @brief  set L2 MPU regions and hmpumask of guest context 
+///         (see hmpu_group_config()), applied by vctx_load()/vctx_switch()
+ret_t vctx_l2_config(vctx_t *ctx, int id, int num, const unsigned long entries[][2], unsigned long mask) {
+
+    for (int i = 0; i < num; i++) {
+        ctx->l2[id][0] = entries[i][0];
+        ctx->l2[id][1] = entries[i][1];
+        id++;
+    }
+
+    ctx->l2_mask = mask;
+
+    return (ret_t){ 0, 0 };
+}
+
+
+/// @name   vctx_load( *ctx )
+/// @brief  load guest context to hardware (first guest, no previous one)
+ret_t vctx_load(vctx_t *ctx) {
+
+    return (ret_t){ 0, vctx_restore(0, ctx) };
+}
+
+
+/// @name   vctx_switch( *prev, *next )
+/// @brief  world switch from prev to next guest, returns number of 
+///         written registers in a1
+ret_t vctx_switch(vctx_t *prev, vctx_t *next) {
+
+    vctx_save(prev);
+
+    return (ret_t){ 0, vctx_restore(prev, next) };
+}
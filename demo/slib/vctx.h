@@ -0,0 +1,42 @@
+/// @file   vctx.h
+/// @brief  RISC-V Shared Library - VS-mode guest context (world) switch, 
+///         HS-mode code, header file
+
+
+#pragma once
+
+#include "tmon.h"
+#include "vmpu.h"
+
+/*
+    Guest context:
+
+    - VS-mode CSRs and guest part of hstatus (VGEIN), hvip
+    - L1 (VS-mode) MPU: hardware regions and vsmpumask (accessed with 
+      vsiselect/vsireg), or shadow configuration of L1 emulation (vmpu.c)
+    - L2 (HS-mode) MPU regions and hmpumask, owned by HS-mode (not saved),
+      not used for guests with L1 emulation (vmpu.c programs L2)
+
+    vctx_switch() saves guest-modifiable state of the outgoing guest and
+    writes only registers which differ for the incoming one.
+*/
+
+#define VCTX_CSR_NUM    9
+
+typedef struct vctx_s {
+    unsigned long   csr[VCTX_CSR_NUM];  // VS-mode CSRs, see vctx.c::VCTX_CSR_LIST
+    unsigned long   hstatus;            // hstatus.VGEIN
+    unsigned long   l1[32][2];          // L1 MPU regions 
+    unsigned long   l1_mask;            // vsmpumask
+    unsigned long   l2[32][2];          // L2 MPU regions 
+    unsigned long   l2_mask;            // hmpumask
+    vmpu_guest_t    *vmpu;              // L1 emulation shadow, 0 - L1 hardware
+} vctx_t;
+
+
+/* HS-mode guest context API */
+
+ret_t vctx_init     ( vctx_t *ctx, vmpu_guest_t *vmpu );
+ret_t vctx_l2_config( vctx_t *ctx, int start_id, int num, const unsigned long entries[][2], unsigned long mask );
+ret_t vctx_load     ( vctx_t *ctx );
+ret_t vctx_switch   ( vctx_t *prev, vctx_t *next );
@@ -0,0 +1,377 @@
+/// @file   vmpu.c 
+/// @brief  RISC-V Shared Library - MPU L1 (VS-mode) trap-and-emulate engine
+///         with L2 (HS-mode) hardware
+
+#include "arch.h"
+#include "smpu.h"
+#include "vmpu.h"
+
+
+/* current guest, host L2 configuration and effective L2 programming cache */
+
+static vmpu_guest_t *guest;
+
+static unsigned long host[32][2];
+static unsigned long host_mask;
+
+static unsigned long eff[32][2];
+static unsigned long eff_mask;
+static int           eff_valid;     // 0 - L2 was programmed outside of L1 emulation
+static int           eff_first[32]; // first L2 slot of guest region, kept across syncs
+
+static unsigned long hw_csrind;     // hstateen0.CSRIND for guests with hardware L1
+
+static void *vmpu_chained;          // previous virtual instruction trap handler
+
+vmpu_stats_t vmpu_stats;
+
+
+/* L1 attributes to S/U-mode rwx permissions { s_rwx, u_rwx } (see smpu.h) */
+
+static const unsigned char vmpu_l1_perm[16][2] = {
+    { 0, 0 },   // 0x00
+    { 1, 0 },   // 0x01 XO
+    { 4, 4 },   // 0x02 SRO
+    { 5, 1 },   // 0x03 SXR
+    { 4, 0 },   // 0x04 RO
+    { 5, 0 },   // 0x05 RX
+    { 6, 0 },   // 0x06 RW
+    { 7, 0 },   // 0x07 RWX
+    { 0, 0 },   // 0x08
+    { 0, 1 },   // 0x09 UXO
+    { 6, 6 },   // 0x0A SRW
+    { 4, 5 },   // 0x0B SRX
+    { 0, 4 },   // 0x0C URO
+    { 0, 5 },   // 0x0D URX
+    { 0, 6 },   // 0x0E URW
+    { 0, 7 },   // 0x0F URWX
+};
+
+/* GPR number to trap stack frame index, -1 if not saved by trap wrappers */
+
+static const signed char vmpu_gpr[32] = {
+    -1,  0, -1, -1, -1,  1,  2,  3,     // zero ra sp gp tp t0 t1 t2
+    -1, -1,  4,  5,  6,  7,  8,  9,     // s0 s1 a0 a1 a2 a3 a4 a5
+    10, 11, -1, -1, -1, -1, -1, -1,     // a6 a7 s2 s3 s4 s5 s6 s7
+    -1, -1, -1, -1, 12, 13, 14, 15,     // s8 s9 s10 s11 t3 t4 t5 t6
+};
+
+
+/// @name   vmpu_combine( id, ov )
+/// @brief  combine guest L1 region with every overlapping host L2 region,
+///         one L2 entry per overlap is stored to ov in host region order
+///         (host priority is kept inside the guest region). L2 cannot
+///         tell VS from VU inside U=1 region, so S/U-mode shared regions get 
+///         union of S/U permissions. Overlaps without access are kept as
+///         deny entries, so lower priority guest regions do not show through
+/// @return number of L2 entries
+static int vmpu_combine(int id, unsigned long ov[32][2]) {
+
+    unsigned long gb = guest->entry[id][0];
+    unsigned long gc = guest->entry[id][1];
+    unsigned long gt = gb + (gc | 0x1F);
+    unsigned long s  = vmpu_l1_perm[gc & 0x0F][0];
+    unsigned long u  = vmpu_l1_perm[gc & 0x0F][1];
+    int n = 0;
+
+    if ( gb & 0x1F ) {
+        WARNING("translated L1 region#%d is not emulated\n", id);
+        return 0;
+    }
+
+    for (int h = 0; h < 32; h++) {
+
+        unsigned long hb, ht, ha, base, top, rwx;
+
+        if ( !(host_mask & (1 << h)) || (host[h][0] & 0x1F) )
+            continue;
+
+        hb = host[h][0];
+        ht = hb + (host[h][1] | 0x1F);
+        ha = host[h][1] & 0x0F;
+
+        if ( (gt < hb) || (gb > ht) )
+            continue;
+
+        base = (gb > hb) ? gb : hb;
+        top  = (gt < ht) ? gt : ht;
+
+        // host .U=1 - VS/VU-mode access, .U=0 - VS-mode only
+        rwx  = (u && (ha & 0x08)) ? ((s | u) & ha & 0x07) : (s & ha & 0x07);
+
+        ov[n][0] = base;
+        ov[n][1] = ((top - base) & ~0x1F) | rwx | ((rwx && u && (ha & 0x08)) ? 0x08 : 0);
+        n++;
+    }
+
+    return n;
+}
+
+
+/// @name   vmpu_layout( l2, *mask, packed )
+/// @brief  place L2 entries of enabled guest regions to L2 slots in guest
+///         region order (priority). Region keeps its previous first slot
+///         unless a higher priority region has grown into it, so one guest
+///         change moves only its own entries. packed = 1 - regions are
+///         packed from slot 0, lowest priority entries which do not fit are
+///         dropped (access is only removed)
+/// @return 0 - OK, -1 - out of L2 slots (packed = 0)
+static int vmpu_layout(unsigned long l2[32][2], unsigned long *mask, int packed) {
+
+    unsigned long ov[32][2];
+    int next = 0, slot, n;
+
+    *mask = 0;
+
+    for (int id = 0; id < 32; id++) {
+
+        if ( !(guest->mask & (1 << id)) )
+            continue;
+
+        n    = vmpu_combine(id, ov);
+        slot = (packed || (eff_first[id] < next)) ? next : eff_first[id];
+
+        if ( slot + n > 32 ) {
+            if ( !packed )
+                return -1;
+            WARNING("no L2 slot left for L1 region#%d\n", id);
+            n = 32 - slot;
+        }
+
+        for (int i = 0; i < n; i++) {
+            l2[slot + i][0] = ov[i][0];
+            l2[slot + i][1] = ov[i][1];
+            *mask |= 1UL << (slot + i);
+        }
+
+        eff_first[id] = slot;
+        next          = slot + n;
+    }
+
+    return 0;
+}
+
+
+/// @name   vmpu_sync()
+/// @brief  compute effective L2 programming of the current guest, L2 slots
+///         are kept per guest region (see vmpu_layout()), regions are
+///         packed only when they do not fit otherwise. Only changed L2
+///         entries and mask are written
+static void vmpu_sync(void) {
+
+    unsigned long l2[32][2], mask = 0;
+
+    if ( guest->mask == 0 ) {
+        // guest L1 disabled, host L2 configuration is used as is
+        for (int id = 0; id < 32; id++) {
+            l2[id][0] = host[id][0];
+            l2[id][1] = host[id][1];
+        }
+        mask = host_mask;
+    }
+    else if ( vmpu_layout(l2, &mask, 0) ) {
+        vmpu_layout(l2, &mask, 1);
+    }
+
+    for (int id = 0; id < 32; id++) {
+
+        if ( !(mask & (1 << id)) )
+            continue;
+
+        if ( !eff_valid || (l2[id][0] != eff[id][0]) || (l2[id][1] != eff[id][1]) ) {
+            // disable slot while it is reprogrammed
+            if ( eff_valid && (eff_mask & (1 << id)) ) {
+                eff_mask &= ~(1 << id);
+                __csrw( CSR_HMPUMASK, eff_mask );
+                vmpu_stats.l2_writes++;
+            }
+            __icsrw( ICSR_HMPU_BASE + (id << 1) + 0, l2[id][0] );
+            __icsrw( ICSR_HMPU_BASE + (id << 1) + 1, l2[id][1] );
+            eff[id][0] = l2[id][0];
+            eff[id][1] = l2[id][1];
+            vmpu_stats.l2_writes += 2;
+        }
+    }
+
+    if ( !eff_valid || (mask != eff_mask) ) {
+        __csrw( CSR_HMPUMASK, mask );
+        eff_mask = mask;
+        vmpu_stats.l2_writes++;
+    }
+
+    eff_valid = 1;
+}
+
+
+/// @name   vmpu_sireg( op, val, *old )
+/// @brief  emulate sireg access for current guest siselect
+static void vmpu_sireg(unsigned long funct3, unsigned long val, int write, unsigned long *old) {
+
+    unsigned long isel = guest->isel;
+    unsigned long *reg, next;
+
+    if ( (isel < ICSR_SMPU_BASE) || (isel >= ICSR_SMPU_BASE + 64) ) {
+        // not an L1 MPU register, pass to guest iCSR (vsiselect/vsireg)
+        __csrw( CSR_VSISELECT, isel );
+        __csrr( *old, CSR_VSIREG );
+        if ( write ) {
+            next = ((funct3 & 3) == 1) ? val : ((funct3 & 3) == 2) ? (*old | val) : (*old & ~val);
+            __csrw( CSR_VSIREG, next );
+        }
+        return;
+    }
+
+    reg  = &guest->entry[(isel - ICSR_SMPU_BASE) >> 1][isel & 1];
+    *old = *reg;
+
+    if ( write ) {
+        next = ((funct3 & 3) == 1) ? val : ((funct3 & 3) == 2) ? (*old | val) : (*old & ~val);
+        if ( next != *reg ) {
+            *reg = next;
+            // enabled region changed, update L2 programming
+            if ( guest->mask & (1 << ((isel - ICSR_SMPU_BASE) >> 1)) )
+                vmpu_sync();
+        }
+    }
+}
+
+
+/// @name   vmpu_trap( *s )
+/// @brief  HS-mode virtual instruction trap handler, emulates guest 
+///         siselect/sireg/smpumask accesses, other traps are chained
+static void vmpu_trap(void *s) {
+
+    register unsigned long *sf = (unsigned long *)s;
+    unsigned long insn, csr, rd, rs1, funct3, val, old, mask;
+    int write;
+
+    __csrr(insn, CSR_STVAL);
+    if ( 0 == insn )
+        insn = *(unsigned long *)sf[17];
+
+    csr    = insn >> 20;
+    rd     = (insn >> 7)  & 0x1F;
+    rs1    = (insn >> 15) & 0x1F;
+    funct3 = (insn >> 12) & 0x07;
+
+    if ( (0 == guest) || ((insn & 0x7F) != 0x73) || ((funct3 & 3) == 0) || 
+         ((csr != CSR_SISELECT) && (csr != CSR_SIREG) && (csr != CSR_SMPUMASK)) ) {
+        return ((void (*)(void*))(vmpu_chained))(s);
+    }
+
+    if ( (vmpu_gpr[rd] < 0 && rd != 0) || (!(funct3 & 4) && vmpu_gpr[rs1] < 0 && rs1 != 0) ) {
+        ERROR("emulated CSR instruction 0x%lx uses GPR not saved in trap stack frame\n", insn);
+        exit(-1);
+    }
+
+    // csrrw{i} always writes, csrr{s|c}{i} write if rs1/uimm is not zero 
+    val   = (funct3 & 4) ? rs1 : (rs1 ? sf[(int)vmpu_gpr[rs1]] : 0);
+    write = ((funct3 & 3) == 1) || (rs1 != 0);
+
+    vmpu_stats.traps++;
+
+    switch ( csr ) {
+        case CSR_SISELECT:
+            old = guest->isel;
+            if ( write )
+                guest->isel = ((funct3 & 3) == 1) ? val : ((funct3 & 3) == 2) ? (old | val) : (old & ~val);
+            break;
+        case CSR_SIREG:
+            vmpu_sireg(funct3, val, write, &old);
+            break;
+        default:    // CSR_SMPUMASK
+            old = guest->mask;
+            if ( write ) {
+                mask = ((funct3 & 3) == 1) ? val : ((funct3 & 3) == 2) ? (old | val) : (old & ~val);
+                if ( mask != old ) {
+                    guest->mask = mask;
+                    vmpu_sync();
+                }
+            }
+            break;
+    }
+
+    if ( rd )
+        sf[(int)vmpu_gpr[rd]] = old;
+
+    sf[17] += 4;        // skip emulated instruction
+}
+
+
+/// @name   vmpu_host_config( id, *entry, enable )
+/// @brief  update host L2 region, effective L2 configuration of the current
+///         guest is reprogrammed (changed entries only)
+ret_t vmpu_host_config(int id, const unsigned long *entry, int enable) {
+
+    host[id][0] = entry[0];
+    host[id][1] = entry[1];
+
+    if ( enable )
+        host_mask |= (1 << id);
+    else
+        host_mask &= ~(1 << id);
+
+    if ( guest )
+        vmpu_sync();
+
+    return (ret_t){ 0, 0 };
+}
+
+
+/// @name   vmpu_guest_switch( *guest )
+/// @brief  switch L1 emulation to another guest, only L2 entries which 
+///         differ from the previous guest are written. Guest 0 - guest with
+///         hardware L1: siselect/sireg are handed back to VS-mode and L2 
+///         is released to HS-mode (effective L2 cache is invalidated)
+ret_t vmpu_guest_switch(vmpu_guest_t *next) {
+
+    if ( 0 == next ) {
+        if ( guest )
+            __csrs( CSR_HSTATEEN0H, hw_csrind );
+        guest     = 0;
+        eff_valid = 0;
+        return (ret_t){ 0, 0 };
+    }
+
+    if ( 0 == guest )
+        __csrc( CSR_HSTATEEN0H, CSR_HSTATEEN0H_CSRIND_MASK );
+
+    guest = next;
+
+    vmpu_sync();
+
+    return (ret_t){ 0, 0 };
+}
+
+
+/// @name   vmpu_init( *guest )
+/// @brief  install HS-mode L1 emulation for VS-mode guest, current L2 
+///         configuration is used as host configuration
+ret_t vmpu_init(vmpu_guest_t *first) {
+
+    // VS-mode siselect/sireg accesses raise virtual instruction traps while 
+    // a guest with L1 emulation is current (vmpu_guest_switch())
+    __csrr( hw_csrind, CSR_HSTATEEN0H );
+    hw_csrind &= CSR_HSTATEEN0H_CSRIND_MASK;
+
+    if ( s_trap_vector[TRAP_EID_VIRTUAL_INST] != (void*)vmpu_trap ) {
+        vmpu_chained = s_trap_vector[TRAP_EID_VIRTUAL_INST];
+        s_trap_vector[TRAP_EID_VIRTUAL_INST] = (void*)vmpu_trap;
+    }
+
+    // current L2 configuration is the host one
+    for (int id = 0; id < 32; id++) {
+        __icsrr( host[id][0], ICSR_HMPU_BASE + (id << 1) + 0 );
+        __icsrr( host[id][1], ICSR_HMPU_BASE + (id << 1) + 1 );
+        eff[id][0] = host[id][0];
+        eff[id][1] = host[id][1];
+    }
+
+    __csrr( host_mask, CSR_HMPUMASK );
+    eff_mask  = host_mask;
+    eff_valid = 1;
+
+    guest = 0;
+
+    return vmpu_guest_switch( first );
+}
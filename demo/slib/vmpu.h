@@ -0,0 +1,52 @@
+/// @file   vmpu.h
+/// @brief  RISC-V Shared Library - MPU L1 (VS-mode) trap-and-emulate engine 
+///         with L2 (HS-mode) hardware, header file
+
+
+#pragma once
+
+#include "tmon.h"
+
+/*
+    VS-mode guest L1 MPU emulation:
+
+    - guest siselect/sireg (hstateen0.CSRIND = 0) and smpumask accesses
+      raise virtual instruction traps (medeleg bit 22 must be set by M-mode),
+      they are emulated by HS-mode against the guest shadow L1 configuration
+    - CSRIND is cleared only while a guest with L1 emulation is current,
+      vmpu_guest_switch(0) restores it for guests with hardware L1 and 
+      invalidates effective L2 cache (HS-mode programs L2 directly)
+    - enabled guest L1 regions are combined with the host L2 regions 
+      (captured by vmpu_init(), updated by vmpu_host_config()): guest region
+      is clipped by every overlapping host region, each overlap takes its own
+      L2 slot (guest/host region priority order), guest region keeps its L2
+      slots across updates unless a higher priority region grows into them,
+      so only L2 entries of the changed region and mask are written
+    - guest with disabled L1 (smpumask = 0) runs with host L2 configuration
+    - emulated instructions must use GPRs saved in the trap stack frame
+      (ra, t0-t6, a0-a7), see __icsr_read()/__icsr_write() (arch.S)
+*/
+
+/* VS-mode guest L1 MPU shadow configuration */
+
+typedef struct vmpu_guest_s {
+    unsigned long   entry[32][2];   // L1 regions (smpu iCSRs)
+    unsigned long   mask;           // smpumask
+    unsigned long   isel;           // siselect
+} vmpu_guest_t;
+
+/* L1 emulation statistics */
+
+typedef struct vmpu_stats_s {
+    unsigned long   traps;          // emulated instructions
+    unsigned long   l2_writes;      // L2 iCSR/mask writes
+} vmpu_stats_t;
+
+extern vmpu_stats_t vmpu_stats;
+
+
+/* HS-mode L1 emulation control */
+
+ret_t vmpu_init         ( vmpu_guest_t *guest );
+ret_t vmpu_host_config  ( int id, const unsigned long *entry, int enable );
+ret_t vmpu_guest_switch ( vmpu_guest_t *guest );
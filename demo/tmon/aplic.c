@@ -0,0 +1,125 @@
+/// @file       aplic.c
+/// @brief      RISC-V Test Monitor - APLIC driver (MSI delivery mode),
+///             M-mode code
+
+#include "arch/arch.h"
+#include "tmon.h"
+#include "aplic.h"
+
+
+#define APLIC_SOURCE_NUM    1023
+
+/* domain register access */
+
+#define APLIC_REG(__domain__, __offs__)     \
+    (*(volatile unsigned long *)(APLIC_M_DOMAIN_BASE + (__domain__) * APLIC_DOMAIN_OFFSET + (__offs__)))
+
+#define APLIC_SOURCECFG_REG(__domain__, __src__)    APLIC_REG(__domain__, APLIC_SOURCECFG + ((__src__) - 1) * 4)
+#define APLIC_TARGET_REG(__domain__, __src__)       APLIC_REG(__domain__, APLIC_TARGET    + ((__src__) - 1) * 4)
+
+
+/// @name   aplic_valid( domain, src )
+/// @brief  check domain and source number
+static int aplic_valid(int domain, unsigned long src) {
+
+    if ( ((APLIC_M_DOMAIN != domain) && (APLIC_S_DOMAIN != domain)) || (src < 1) || (src > APLIC_SOURCE_NUM) ) {
+        ERROR("APLIC domain %d/source #%ld is invalid\n", domain, src);
+        return 0;
+    }
+
+    return 1;
+}
+
+
+/// @name   aplic_init()
+/// @brief  MSI delivery mode for M- and S-domains, MSI addresses of
+///         hart 0 M-level and S-level IMSIC interrupt files
+int aplic_init(void) {
+
+    APLIC_REG(APLIC_M_DOMAIN, APLIC_DOMAINCFG) = 0;
+    APLIC_REG(APLIC_S_DOMAIN, APLIC_DOMAINCFG) = 0;
+
+    APLIC_REG(APLIC_M_DOMAIN, APLIC_MMSIADDRCFG)  = (unsigned long)__mmsi_base >> APLIC_PAGE_BITS;
+    APLIC_REG(APLIC_M_DOMAIN, APLIC_MMSIADDRCFGH) = 0;
+    APLIC_REG(APLIC_M_DOMAIN, APLIC_SMSIADDRCFG)  = (unsigned long)__smsi_base >> APLIC_PAGE_BITS;
+    APLIC_REG(APLIC_M_DOMAIN, APLIC_SMSIADDRCFGH) = 0;
+
+    APLIC_REG(APLIC_M_DOMAIN, APLIC_DOMAINCFG) = (1 << APLIC_DOMAINCFG_IE_BIT) | (1 << APLIC_DOMAINCFG_DM_BIT);
+    APLIC_REG(APLIC_S_DOMAIN, APLIC_DOMAINCFG) = (1 << APLIC_DOMAINCFG_IE_BIT) | (1 << APLIC_DOMAINCFG_DM_BIT);
+
+    return 0;
+}
+
+
+/// @name   aplic_source( domain, src, mode )
+/// @brief  set source mode (enum source_mode) and enable the source, S-domain
+///         sources are delegated by M-domain. INACTIVE mode disables source,
+///         S-domain source is returned to M-domain
+int aplic_source(int domain, unsigned long src, unsigned long mode) {
+
+    if ( !aplic_valid(domain, src) )
+        return -1;
+
+    if ( APLIC_S_DOMAIN == domain ) {
+        APLIC_SOURCECFG_REG(APLIC_M_DOMAIN, src) = (INACTIVE != mode) ? (1 << APLIC_SOURCECFG_D_BIT) : 0;
+    }
+
+    APLIC_SOURCECFG_REG(domain, src) = mode & APLIC_SOURCECFG_SM_MASK;
+
+    if ( INACTIVE != mode )
+        APLIC_REG(domain, APLIC_SETIENUM) = src;
+    else
+        APLIC_REG(domain, APLIC_CLRIENUM) = src;
+
+    return 0;
+}
+
+
+/// @name   aplic_target( domain, src, eiid )
+/// @brief  forward source as MSI with EIID to hart 0 interrupt file of
+///         the domain (M-level or S-level IMSIC file)
+int aplic_target(int domain, unsigned long src, unsigned long eiid) {
+
+    if ( !aplic_valid(domain, src) )
+        return -1;
+
+    APLIC_TARGET_REG(domain, src) = eiid & APLIC_TARGETS_EIID_MASK;
+
+    return 0;
+}
+
+
+/// @name   aplic_setip( domain, src, num )
+/// @brief  set pending num sources starting from src (burst), one setipnum
+///         write per source
+int aplic_setip(int domain, unsigned long src, unsigned long num) {
+
+    if ( !aplic_valid(domain, src) )
+        return -1;
+
+    if ( (num < 1) || (num > APLIC_SOURCE_NUM - src + 1) ) {
+        ERROR("APLIC burst of %ld sources from #%ld is invalid\n", num, src);
+        return -1;
+    }
+
+    for (unsigned long i = 0; i < num; i++)
+        APLIC_REG(domain, APLIC_SETIPNUM) = src + i;
+
+    return 0;
+}
+
+
+/// @name   aplic_genmsi( domain, eiid )
+/// @brief  send extempore MSI with EIID to hart 0 interrupt file of the domain
+int aplic_genmsi(int domain, unsigned long eiid) {
+
+    if ( !aplic_valid(domain, 1) )
+        return -1;
+
+    while ( (APLIC_REG(domain, APLIC_GENMSI) >> APLIC_GENMSI_BUSY_BIT) & APLIC_GENMSI_BUSY_MASK )
+        ;
+
+    APLIC_REG(domain, APLIC_GENMSI) = eiid & APLIC_GENMSI_EIID_MASK;
+
+    return 0;
+}
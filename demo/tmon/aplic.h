@@ -0,0 +1,22 @@
+/// @file       aplic.h
+/// @brief      RISC-V Test Monitor - APLIC driver (MSI delivery mode),
+///             M-mode code
+
+
+/*
+    APLIC M-level domain (root) and S-level child domain in MSI delivery mode:
+
+    - M-domain holds MSI address configuration of both domains,
+      M-level IMSIC file (__mmsi_base) and S-level file (__smsi_base)
+    - source of S-domain is delegated by M-domain (sourcecfg.D, child 0)
+    - target[src] selects EIID of the hart 0 interrupt file of the domain,
+      guest index is 0 (guest files do not follow APLIC address layout)
+    - setipnum sets source pending (wired source is emulated for edge
+      and detached modes), genmsi sends EIID as extempore MSI
+*/
+
+extern int aplic_init  ( void );
+extern int aplic_source( int domain, unsigned long src, unsigned long mode );
+extern int aplic_target( int domain, unsigned long src, unsigned long eiid );
+extern int aplic_setip ( int domain, unsigned long src, unsigned long num );
+extern int aplic_genmsi( int domain, unsigned long eiid );
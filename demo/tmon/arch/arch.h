@@ -27,3 +27,7 @@ extern void __csr_write(unsigned long csr, unsigned long data);
 // S-mode iCSR access (arch.S)
 extern unsigned long __icsr_read(unsigned long csr);
 extern void __icsr_write(unsigned long csr, unsigned long data);
+
+// privilege drop without environment call (arch.S)
+extern long m_priv_drop(void *mode);
+extern long s_priv_drop(void *mode);
@@ -44,6 +44,20 @@
 #define CSR_MINSTRET        0x0b02  // [MRW] Machine instructions-retired counter
 #define CSR_MCYCLEH         0x0b80  // [MRW] Upper 32 bits of MCYCLE, RV32 only
 #define CSR_MINSTRETH       0x0b82  // [MRW] Upper 32 bits of MINSTRET, RV32 only.
+#define CSR_MHPMCOUNTER3    0x0b03  // [MRW] Machine performance-monitoring counter 3 (3..31).
+#define CSR_MHPMCOUNTERH3   0x0b83  // [MRW] Upper 32 bits of mhpmcounter3, RV32 only.
+// Machine Counter Setup
+#define CSR_MCOUNTINHIBIT   0x0320  // [MRW] Machine counter-inhibit register.
+#define CSR_MHPMEVENT3      0x0323  // [MRW] Machine performance-monitoring event selector 3 (3..31).
+#define CSR_MHPMEVENTH3     0x0723  // [MRW] Upper 32 bits of mhpmevent3, RV32 only (Sscofpmf).
+#define CSR_SCOUNTOVF       0x0DA0  // [SRO] Supervisor count overflow (Sscofpmf).
+// Unprivileged Counter/Timers
+#define CSR_CYCLE           0x0c00  // [URO] Cycle counter for RDCYCLE instruction.
+#define CSR_TIME            0x0c01  // [URO] Timer for RDTIME instruction.
+#define CSR_INSTRET         0x0c02  // [URO] Instructions-retired counter for RDINSTRET instruction.
+#define CSR_CYCLEH          0x0c80  // [URO] Upper 32 bits of cycle, RV32 only.
+#define CSR_TIMEH           0x0c81  // [URO] Upper 32 bits of time, RV32 only.
+#define CSR_INSTRETH        0x0c82  // [URO] Upper 32 bits of instret, RV32 only.
 // Machine Information Registers
 #define CSR_MVENDORID       0x0F11  // [MRO] Vendor ID.
 #define CSR_MARCHID         0x0F12  // [MRO] Architecture ID.
@@ -67,10 +81,36 @@
 #define CSR_STVAL           0x0143  // [SRW] Supervisor bad address or instruction.
 #define CSR_SIP             0x0144  // [SRW] Supervisor interrupt pending.
 #define CSR_SIPH 			0x0154	// [SRW] Upper 32-bits of sip
+#define CSR_STIMECMP        0x014D  // [SRW] Supervisor timer compare (Sstc).
+#define CSR_STIMECMPH       0x015D  // [SRW] Upper 32 bits of stimecmp, RV32 only (Sstc).
+#define CSR_STOPI			0x0DB0	// [SRO] Supervisor top interrupt
+#define CSR_STOPEI			0x015C	// [SRW] Supervisor top external interrupt
 
 
 // Hypervisor Extended Supervisor Registers
 #define CSR_HSTATUS			0x0600	// [SRW] Hypervisor Status
+#define CSR_HEDELEG			0x0602	// [SRW] Hypervisor exception delegation register
+#define CSR_HIDELEG			0x0603	// [SRW] Hypervisor interrupt delegation register
+#define CSR_HIE				0x0604	// [SRW] Hypervisor interrupt-enable register
+#define CSR_HCOUNTEREN		0x0606	// [SRW] Hypervisor counter enable
+#define CSR_HGEIE			0x0607	// [SRW] Hypervisor guest external interrupt-enable register
+#define CSR_HVIP			0x0645	// [SRW] Hypervisor virtual interrupt pending
+#define CSR_HGEIP			0x0E12	// [SRO] Hypervisor guest external interrupt pending
+#define CSR_HSTATEEN0		0x060C	// [SRW] Hypervisor state enable 0
+#define CSR_HSTATEEN0H		0x061C	// [SRW] Upper 32-bits of hstateen0
+
+// Virtual Supervisor Registers (accessed as S-mode registers in VS-mode)
+#define CSR_VSSTATUS		0x0200	// [SRW] Virtual supervisor status register
+#define CSR_VSIE			0x0204	// [SRW] Virtual supervisor interrupt-enable register
+#define CSR_VSTVEC			0x0205	// [SRW] Virtual supervisor trap handler base address
+#define CSR_VSSCRATCH		0x0240	// [SRW] Virtual supervisor scratch register
+#define CSR_VSEPC			0x0241	// [SRW] Virtual supervisor exception program counter
+#define CSR_VSCAUSE			0x0242	// [SRW] Virtual supervisor trap cause
+#define CSR_VSTVAL			0x0243	// [SRW] Virtual supervisor bad address or instruction
+#define CSR_VSIP			0x0244	// [SRW] Virtual supervisor interrupt pending
+#define CSR_VSTOPEI			0x025C	// [SRW] Virtual supervisor top external interrupt
+#define CSR_VSTOPI			0x0EB0	// [SRO] Virtual supervisor top interrupt
+#define CSR_VSATP			0x0280	// [SRW] Virtual supervisor address translation and protection
 
 
 // S-MODE PMP (RISC-V SPMP)
@@ -163,6 +203,10 @@
 #define CSR_HSTATUS_VGEIN_SHIFT 12
 #define CSR_HSTATUS_VGEIN_MASK  (0x3F << CSR_HSTATUS_VGEIN_SHIFT)
 
+// HSTATEEN0H bit fields (hstateen0[63:32])
+#define CSR_HSTATEEN0H_CSRIND_BIT   (60 - 32)   // siselect/sireg access in VS-mode
+#define CSR_HSTATEEN0H_CSRIND_MASK  BIT(CSR_HSTATEEN0H_CSRIND_BIT)
+
 // HSTATUS bit fields
 #define CSR_HSTATUS_VGEIN_SHIFT 12
 #define CSR_HSTATUS_VGEIN_MASK  (0x3F << CSR_HSTATUS_VGEIN_SHIFT)
@@ -187,6 +231,14 @@
 
 // SIE bit definitions
 
+// MHPMEVENTH bit definitions (Sscofpmf)
+#define CSR_MHPMEVENTH_OF_BIT       31  // overflow, LCOFI is raised when set by wrap
+#define CSR_MHPMEVENTH_MINH_BIT     30  // inhibit counting in M-mode
+#define CSR_MHPMEVENTH_SINH_BIT     29  // inhibit counting in S/HS-mode
+#define CSR_MHPMEVENTH_UINH_BIT     28  // inhibit counting in U-mode
+#define CSR_MHPMEVENTH_VSINH_BIT    27  // inhibit counting in VS-mode
+#define CSR_MHPMEVENTH_VUINH_BIT    26  // inhibit counting in VU-mode
+
 // HIE bit definitions
 #define CSR_HIE_VSSIE_BIT      2
 #define CSR_HIE_VSTIE_BIT      6
@@ -315,6 +367,8 @@
 #define IMSIC_HART0_S_IFILE                     ((CONFIG_IMSIC_S_HART0_BASE) + 0x0)
 #define IMSIC_HART0_S_IFILE_SETEIPNUM_LE_OFFS   ((CONFIG_IMSIC_S_HART0_BASE) + 0x0)
 
+#define IMSIC_GUEST_IFILE_STRIDE                0x1000  // guest interrupt files follow S-level file
+
 #define IMSIC_IPRIO_REG(n)        (0x30 + ((n) >> 2))
 
 #define M_EI_DELIVERY_REG         0x70
@@ -324,6 +378,11 @@
 
 #define M_EI_DELIVERY_ENA         0x1
 
+#define S_EI_DELIVERY_REG         0x70
+#define S_EI_THRESHOLD_REG        0x72
+#define S_EI_PENDING_REG(x)       (0x80 + (x))
+#define S_EI_ENABLE_REG(x)        (0xC0 + (x))
+
 // APLIC
 #define APLIC_HART0_BASE          0x40000000
 #define APLIC_DOMAIN_OFFSET       0x10000
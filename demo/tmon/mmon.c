@@ -1,9 +1,16 @@
 /// @file   mmon.c
 /// @brief  RISC-V Test Monitor - M-mode Monitor Services
 
+#include "arch/arch.h"
 #include "tmon.h"
+#include "aplic.h"
+#include "work.h"
+#include "prof.h"
+#include "stats.h"
+#include "tpoint.h"
 
 typedef void (*tmon_ecall_t)(void *s);
+typedef int  (*tmon_csrop_t)(unsigned long csr, unsigned long *val);
 
 
 static void mmon_fail  (void *s);
@@ -17,6 +24,7 @@ static void mmon_icsrw (void *s);
 static void mmon_icsrs (void *s);
 static void mmon_icsrc (void *s);
 static void mmon_priv  (void *s);
+static void mmon_qpriv (void *s);
 static void mmon_expect(void *s);
 static void mmon_verify(void *s);
 static void mmon_mswi  (void *s);
@@ -24,6 +32,11 @@ static void mmon_sswi  (void *s);
 static void mmon_mmsi  (void *s);
 static void mmon_smsi  (void *s);
 static void mmon_cb    (void *s);
+static void mmon_gmsi  (void *s);
+static void mmon_aplic (void *s);
+static void mmon_bmsi  (void *s);
+static void mmon_stats (void *s);
+static void mmon_tpoint(void *s);
 
 
 static tmon_ecall_t m_fid_vector[] = {
@@ -45,9 +58,114 @@ static tmon_ecall_t m_fid_vector[] = {
     mmon_mmsi,          // FID=15 - TMON_FID_MMSI
     mmon_smsi,          // FID=16 - TMON_FID_SMSI
     mmon_cb,            // FID=17 - TMON_FID_CB
+    mmon_qpriv,         // FID=18 - TMON_FID_QPRIV
+    mmon_gmsi,          // FID=19 - TMON_FID_GMSI
+    mmon_aplic,         // FID=20 - TMON_FID_APLIC
+    mmon_bmsi,          // FID=21 - TMON_FID_BMSI
+    mmon_stats,         // FID=22 - TMON_FID_STATS
+    mmon_tpoint,        // FID=23 - TMON_FID_TPOINT
 };
 
 
+/* M-mode CSR allow-list for TMON_FID_CSRx services. 
+   Trap context CSRs (mstatus, mepc, mcause) are restored from the trap 
+   stack frame on exit, so they are not accessible from here. CSRs which
+   give control over M-mode (trap vector, delegation, mscratch, mseccfg)
+   are read-only or not listed: writable ones are safe for S/U callers. */
+
+#define MMON_CSR_RW_LIST(X)     \
+    X(CSR_MIE)                  \
+    X(CSR_MIEH)                 \
+    X(CSR_MIP)                  \
+    X(CSR_MIPH)                 \
+    X(CSR_MCOUNTEREN)           \
+    X(CSR_MENVCFG)              \
+    X(CSR_MENVCFGH)             \
+    X(CSR_MCYCLE)               \
+    X(CSR_MCYCLEH)              \
+    X(CSR_MINSTRET)             \
+    X(CSR_MINSTRETH)
+
+#define MMON_CSR_RO_LIST(X)     \
+    X(CSR_MVENDORID)            \
+    X(CSR_MARCHID)              \
+    X(CSR_MIMPID)               \
+    X(CSR_MHARTID)              \
+    X(CSR_MISA)                 \
+    X(CSR_MEDELEG)              \
+    X(CSR_MIDELEG)              \
+    X(CSR_MIDELEGH)             \
+    X(CSR_MTVEC)                \
+    X(CSR_MTVAL)                \
+    X(CSR_MSECCFG)              \
+    X(CSR_MSECCFGH)             \
+    X(CSR_MTOPI)
+
+/* M-mode iCSR allow-list (miselect index ranges) for TMON_FID_ICSRx services */
+
+#define MMON_ICSR_ALLOWED(__i__)                                    \
+    ((((__i__) >= IMSIC_IPRIO_REG(0))    && ((__i__) <= IMSIC_IPRIO_REG(63)))    ||  \
+     ((__i__) == M_EI_DELIVERY_REG)      || ((__i__) == M_EI_THRESHOLD_REG)        ||  \
+     (((__i__) >= M_EI_PENDING_REG(0))   && ((__i__) <= M_EI_ENABLE_REG(63))))
+
+/* Constant CSR access stubs, one switch case per allowed CSR (no self-modifying code) */
+
+#define MMON_CSRR_CASE(__csr__)     case __csr__: __csrr(*val, __csr__); return 0;
+#define MMON_CSRW_CASE(__csr__)     case __csr__: __csrw(__csr__, *val); return 0;
+#define MMON_CSRS_CASE(__csr__)     case __csr__: __csrs(__csr__, *val); return 0;
+#define MMON_CSRC_CASE(__csr__)     case __csr__: __csrc(__csr__, *val); return 0;
+
+
+static int mmon_csr_read (unsigned long csr, unsigned long *val) {
+    switch (csr) { MMON_CSR_RW_LIST(MMON_CSRR_CASE) MMON_CSR_RO_LIST(MMON_CSRR_CASE) }
+    return -1;
+}
+
+static int mmon_csr_write(unsigned long csr, unsigned long *val) {
+    switch (csr) { MMON_CSR_RW_LIST(MMON_CSRW_CASE) }
+    return -1;
+}
+
+static int mmon_csr_set  (unsigned long csr, unsigned long *val) {
+    switch (csr) { MMON_CSR_RW_LIST(MMON_CSRS_CASE) }
+    return -1;
+}
+
+static int mmon_csr_clear(unsigned long csr, unsigned long *val) {
+    switch (csr) { MMON_CSR_RW_LIST(MMON_CSRC_CASE) }
+    return -1;
+}
+
+
+static int mmon_icsr_read (unsigned long icsr, unsigned long *val) {
+    if (!MMON_ICSR_ALLOWED(icsr)) return -1;
+    __csrw(CSR_MISELECT, icsr);
+    __csrr(*val, CSR_MIREG);
+    return 0;
+}
+
+static int mmon_icsr_write(unsigned long icsr, unsigned long *val) {
+    if (!MMON_ICSR_ALLOWED(icsr)) return -1;
+    __csrw(CSR_MISELECT, icsr);
+    __csrw(CSR_MIREG, *val);
+    return 0;
+}
+
+static int mmon_icsr_set  (unsigned long icsr, unsigned long *val) {
+    if (!MMON_ICSR_ALLOWED(icsr)) return -1;
+    __csrw(CSR_MISELECT, icsr);
+    __csrs(CSR_MIREG, *val);
+    return 0;
+}
+
+static int mmon_icsr_clear(unsigned long icsr, unsigned long *val) {
+    if (!MMON_ICSR_ALLOWED(icsr)) return -1;
+    __csrw(CSR_MISELECT, icsr);
+    __csrc(CSR_MIREG, *val);
+    return 0;
+}
+
+
 /// @name  void m_exc_ecall( *s )
 /// @brief M-mode environment calls entry point
 void m_exc_ecall(void *s ) {
@@ -56,10 +174,63 @@ void m_exc_ecall(void *s ) {
 
     fid_t fid = (fid_t)(sf[4]);
 
+    TPOINT(TP_ECALL, fid, sf[5]);
+
     m_fid_vector[fid](s);
 
     sf[17] += 4;        // move EPC to the next (after ecall) instruction   
 
+    if ( WORK_TRIGGER_EXIT == m_work.trigger ) {
+        work_run(&m_work, s);               // monitor exit point, bottom-halves
+    }
+
+    return;
+}
+
+
+/// @name   m_ring_drain()
+/// @brief  serve asynchronous requests posted to tmon_ring by lower privilege 
+///         levels, called by M-mode trap wrappers on every trap entry
+void m_ring_drain(void) {
+
+    static unsigned long busy = 0;
+
+    register unsigned long tail;
+    unsigned long sf[6];                // a0/a1 part of trap stack frame
+
+    if (busy) {
+        return;                         // nested trap, outer drain is in progress 
+    }
+
+    busy = 1;
+
+    for (tail = tmon_ring.tail; tail != tmon_ring.head; tail++) {
+
+        asm volatile ("fence r, r" ::: "memory");   // read request after head
+
+        sf[4] = tmon_ring.req[tail & (TMON_RING_SIZE - 1)][0];
+        sf[5] = tmon_ring.req[tail & (TMON_RING_SIZE - 1)][1];
+
+        asm volatile ("fence rw, w" ::: "memory");  // release entry before tail
+
+        tmon_ring.tail = tail + 1;
+
+        switch ( sf[4] ) {
+            case TMON_FID_EXPECT:
+            case TMON_FID_MSWI:
+            case TMON_FID_SSWI:
+            case TMON_FID_MMSI:
+            case TMON_FID_SMSI:
+            case TMON_FID_GMSI:
+                m_fid_vector[sf[4]](sf);
+                break;
+            default:
+                WARNING("FID=%ld can not be posted to request ring, dropped\n", sf[4]);
+        }
+    }
+
+    busy = 0;
+
     return;
 }
 
@@ -82,100 +253,142 @@ static void mmon_exit (void *s ) {
 
     register unsigned long *sf = (unsigned long *)s;
 
+    prof_flush();       // pending profiler samples
+
+    if ( m_stats_on || s_stats_on )
+        stats_dump();
+
     exit(sf[5]);        // exit(a1)     
 }
 
+/// @name   mmon_csr_serve( *s, op )
+/// @brief  apply CSR/iCSR operation to single request or to request array, 
+///         stops at the first CSR which is not in the allow-list. Requests
+///         have to be in caller memory (written back by read operations),
+///         array holds up to TMON_CSR_ARRAY_MAX requests
+/// @return a0 = 0 - OK, -1 - access denied; a1 = number of served requests 
+static void mmon_csr_serve(void *s, tmon_csrop_t op) {
+
+    register unsigned long *sf  = (unsigned long *)s;
+    register tmon_csr_t    *req = (tmon_csr_t *)sf[5];      // in a1
+    register unsigned long  num = 1;
+    register unsigned long  i;
+    register int            wr  = (mmon_csr_read == op) || (mmon_icsr_read == op);
+
+    sf[5] = 0;
+
+    if ( !tmon_caller_access(s, (unsigned long)req, sizeof(*req), 0) ) {
+        ERROR("CSR request 0x%lx is not accessible by caller\n", (unsigned long)req);
+        sf[4] = -1;
+        return;
+    }
+
+    if (req->csr & TMON_CSR_ARRAY) {
+        num = req->csr & ~TMON_CSR_ARRAY;
+        req = (tmon_csr_t *)req->val;
+    }
+
+    if ( num > TMON_CSR_ARRAY_MAX || !tmon_caller_access(s, (unsigned long)req, num * sizeof(tmon_csr_t), wr) ) {
+        ERROR("CSR request array 0x%lx of %ld entries is not accessible by caller\n", (unsigned long)req, num);
+        sf[4] = -1;
+        return;
+    }
+
+    for (i = 0; i < num; i++) {
+        if (0 != op(req[i].csr, &req[i].val)) {
+            WARNING("CSR/iCSR 0x%lx is not in M-mode monitor allow-list\n", req[i].csr);
+            break;
+        }
+    }
+
+    sf[4] = (i == num) ? 0 : -1;    // a0 = OK/error
+    sf[5] = i;                      // a1 = served requests
+}
+
+
 /// @name   mmon_csrr( *s ) 
-/// @brief
+/// @brief  read CSR(s), TMON_FID_CSRR
 static void mmon_csrr (void *s ) {
 
-    register unsigned long *sf = (unsigned long *)s;
-
-    WARNING("not implemented\n");
-    sf[4] = 0;          // a0 = OK
+    mmon_csr_serve(s, mmon_csr_read);
 }
 
 
 /// @name   mmon_csrw ( *s )
-/// @brief
+/// @brief  write CSR(s), TMON_FID_CSRW
 static void mmon_csrw (void *s ) {
 
-    register unsigned long *sf = (unsigned long *)s;
-
-    WARNING("not implemented\n");
-    sf[4] = 0;          // a0 = OK
+    mmon_csr_serve(s, mmon_csr_write);
 }
 
 
 /// @name   mmon_csrs( *s )
-/// @brief
+/// @brief  set CSR(s) bits by mask, TMON_FID_CSRS
 static void mmon_csrs (void *s ) {
 
-    register unsigned long *sf = (unsigned long *)s;
-
-    WARNING("not implemented\n");
-    sf[4] = 0;          // a0 = OK
+    mmon_csr_serve(s, mmon_csr_set);
 }
 
 
 /// @name   mmon_csrc( *s )
-/// @brief
+/// @brief  clear CSR(s) bits by mask, TMON_FID_CSRC
 static void mmon_csrc (void *s ) {
 
-    register unsigned long *sf = (unsigned long *)s;
-
-    WARNING("not implemented\n");
-    sf[4] = 0;          // a0 = OK
+    mmon_csr_serve(s, mmon_csr_clear);
 }
 
 
 /// @name   mmon_icsrr( *s )
-/// @brief
+/// @brief  read M-level iCSR(s), TMON_FID_ICSRR
 static void mmon_icsrr(void *s ) {
 
-    register unsigned long *sf = (unsigned long *)s;
+    register unsigned long miselect;
 
-    WARNING("not implemented\n");
-    sf[4] = 0;          // a0 = OK
+    __csrr(miselect, CSR_MISELECT);         // interrupted code may own miselect
+    mmon_csr_serve(s, mmon_icsr_read);
+    __csrw(CSR_MISELECT, miselect);
 }
 
 
 /// @name   mmon_icsrw( *s )
-/// @brief
+/// @brief  write M-level iCSR(s), TMON_FID_ICSRW
 static void mmon_icsrw(void *s) {
 
-    register unsigned long *sf = (unsigned long *)s;
+    register unsigned long miselect;
 
-    WARNING("not implemented\n");
-    sf[4] = 0;          // a0 = OK
+    __csrr(miselect, CSR_MISELECT);
+    mmon_csr_serve(s, mmon_icsr_write);
+    __csrw(CSR_MISELECT, miselect);
 }
 
 
 /// @name   mmon_icsrs( *s )
-/// @brief
+/// @brief  set M-level iCSR(s) bits by mask, TMON_FID_ICSRS
 static void mmon_icsrs(void *s ) {
 
-    register unsigned long *sf = (unsigned long *)s;
+    register unsigned long miselect;
 
-    WARNING("not implemented\n");
-    sf[4] = 0;          // a0 = OK
+    __csrr(miselect, CSR_MISELECT);
+    mmon_csr_serve(s, mmon_icsr_set);
+    __csrw(CSR_MISELECT, miselect);
 }
 
 
 /// @name   mmon_icsrc( *s )
-/// @brief
+/// @brief  clear M-level iCSR(s) bits by mask, TMON_FID_ICSRC
 static void mmon_icsrc(void *s ) {
 
-    register unsigned long *sf = (unsigned long *)s;
+    register unsigned long miselect;
 
-    WARNING("not implemented\n");
-    sf[4] = 0;          // a0 = OK
+    __csrr(miselect, CSR_MISELECT);
+    mmon_csr_serve(s, mmon_icsr_clear);
+    __csrw(CSR_MISELECT, miselect);
 }
 
 
-/// @name   mmon_priv ( *s )
+/// @name   mmon_priv_switch ( *s, quiet )
 /// @brief  M-mode version of privilege switch FID handler
-static void mmon_priv (void *s ) {
+static void mmon_priv_switch (void *s, int quiet) {
 
     register unsigned long *sf = (unsigned long *)s;
 
@@ -186,6 +399,27 @@ static void mmon_priv (void *s ) {
     unsigned long mpp     = ((status >> 11) & 0x3); // machine previous privilege mode (equal to mstatus.MPP)
     unsigned long mpv     = ((statush >> 7) & 0x1); // machine previous virtualization mode (equal to mstatush.MPV)
     unsigned long mode    = ((mpv << 2) | mpp);
+    unsigned long epc, vsstatus;
+
+    if ( next & TMON_PRIV_RESUME ) {
+
+        // exit of S/VS-level trap wrapper: continue at the left trap's epc  
+        // with its interrupt enable restored, caller's a1 is returned unchanged
+
+        next  &= ~TMON_PRIV_RESUME;
+        sf[5]  = next;
+
+        if ( mpv ) {
+            __csrr(epc, CSR_VSEPC);
+            __csrr(vsstatus, CSR_VSSTATUS);
+            __csrs(CSR_VSSTATUS, (vsstatus >> CSR_xSTATUS_SPIE_BIT & 1) << CSR_xSTATUS_SIE_BIT);
+        } else {
+            __csrr(epc, CSR_SEPC);
+            status |= (status >> CSR_xSTATUS_SPIE_BIT & 1) << CSR_xSTATUS_SIE_BIT;
+        }
+
+        sf[17] = epc - 4;               // m_exc_ecall() moves EPC past ecall
+    }
 
     switch ( next ) {
         case 0x00:
@@ -193,13 +427,16 @@ static void mmon_priv (void *s ) {
         case 0x03:
         case 0x04:
         case 0x05:
-            TRACE("%s to %s privilege mode switch\n", priv_s[mode], priv_s[next]);
+            if (!quiet)
+                TRACE("%s to %s privilege mode switch\n", priv_s[mode], priv_s[next]);
             break;
         default:
             ERROR("target privilege mode specification {%ld} is invalid\n", next);
             exit(-1);
     }
 
+    TPOINT(TP_PRIV, next, sf[17]);
+
     // update privilege mode stack in status/statush values 
     sf[16] = (status & ~(3 << 11)) | ((next & 0x03) << 11);
     sf[19] = (statush & ~(1 << 7)) | ((next >> 2) << 7);
@@ -210,6 +447,22 @@ static void mmon_priv (void *s ) {
 }
 
 
+/// @name   mmon_priv ( *s )
+/// @brief  privilege switch with trace (TMON_FID_PRIV)
+static void mmon_priv (void *s ) {
+
+    mmon_priv_switch(s, 0);
+}
+
+
+/// @name   mmon_qpriv ( *s )
+/// @brief  quiet privilege switch (TMON_FID_QPRIV)
+static void mmon_qpriv (void *s ) {
+
+    mmon_priv_switch(s, 1);
+}
+
+
 /// @name   mmon_expect( *s )
 /// @brief  set expectation of specified trap 
 /// @param  
@@ -298,6 +551,211 @@ static void mmon_smsi  (void *s) {
 }
 
 
+/// @name   mmon_gmsi( *s )
+/// @brief  send MSI to IMSIC guest interrupt file, or assert/de-assert 
+///         VS external interrupt with hvip.VSEIP (guest file 0), see tmon_gmsi()
+/// @return a0 = 0 - OK, -1 - guest interrupt file is not implemented
+static void mmon_gmsi  (void *s) {
+
+    register unsigned long *sf    = (unsigned long *)s;
+
+    sf[4] = tmon_gmsi(sf[5]);                           // in a1
+}
+
+
+/// @name   mmon_aplic( *s )
+/// @brief  APLIC configuration and injection request, TMON_FID_APLIC
+/// @return a0 = 0 - OK, -1 - invalid request
+static void mmon_aplic (void *s) {
+
+    register unsigned long *sf    = (unsigned long *)s;
+    register tmon_aplic_t  *req   = (tmon_aplic_t *)sf[5];      // in a1
+    int ret;
+
+    if ( !tmon_caller_access(s, (unsigned long)req, sizeof(*req), 0) ) {
+        ERROR("APLIC request 0x%lx is not accessible by caller\n", (unsigned long)req);
+        sf[4] = -1;
+        return;
+    }
+
+    switch (req->op) {
+        case TMON_APLIC_INIT:
+            ret = aplic_init();
+            break;
+        case TMON_APLIC_SOURCE:
+            ret = aplic_source(req->domain, req->src, req->arg);
+            break;
+        case TMON_APLIC_TARGET:
+            ret = aplic_target(req->domain, req->src, req->arg);
+            break;
+        case TMON_APLIC_SETIP:
+            ret = aplic_setip(req->domain, req->src, req->arg);
+            break;
+        case TMON_APLIC_GENMSI:
+            ret = aplic_genmsi(req->domain, req->src);
+            break;
+        default:
+            WARNING("APLIC request %ld is not supported\n", req->op);
+            ret = -1;
+    }
+
+    sf[4] = ret;        // a0 = OK/error
+}
+
+
+/// @name   mmon_bmsi( *s )
+/// @brief  send burst of MSIs to M-level or S-level IMSIC file in one call, 
+///         EIIDs are taken from list or range, TMON_FID_BMSI
+/// @return a0 = 0 - OK, -1 - invalid level, burst or request; a1 = number
+///         of sent MSIs
+static void mmon_bmsi  (void *s) {
+
+    register unsigned long *sf    = (unsigned long *)s;
+    register tmon_bmsi_t   *req   = (tmon_bmsi_t *)sf[5];       // in a1
+    register volatile long *msi;
+    register unsigned long  i;
+
+    if ( !tmon_caller_access(s, (unsigned long)req, sizeof(*req), 0) || req->num > TMON_BMSI_MAX ||
+         (req->list && !tmon_caller_access(s, (unsigned long)req->list, req->num * sizeof(long), 0)) ) {
+        ERROR("burst MSI request 0x%lx is invalid or not accessible by caller\n", (unsigned long)req);
+        sf[4] = -1;
+        sf[5] = 0;
+        return;
+    }
+
+    switch (req->level) {
+        case TMON_BMSI_M:   msi = __mmsi_base;  break;
+        case TMON_BMSI_S:   msi = __smsi_base;  break;
+        default:
+            sf[4] = -1;
+            sf[5] = 0;
+            return;
+    }
+
+    if (req->list)
+        for (i = 0; i < req->num; i++)
+            msi[0] = req->list[i];
+    else
+        for (i = 0; i < req->num; i++)
+            msi[0] = req->first + i;
+
+    sf[4] = 0;
+    sf[5] = req->num;
+}
+
+
+/// @name   mmon_stats( *s )
+/// @brief  per-cause trap statistics of M-level or S-level, TMON_FID_STATS
+/// @return a0 = 0 - OK, -1 - invalid level, op or buffer; a1 = number of read entries
+static void mmon_stats (void *s) {
+
+    register unsigned long *sf    = (unsigned long *)s;
+    register tmon_stats_t  *req   = (tmon_stats_t *)sf[5];      // in a1
+    register unsigned long  num;
+    register int            ret;
+
+    sf[5] = 0;
+
+    if ( !tmon_caller_access(s, (unsigned long)req, sizeof(*req), 0) ) {
+        ERROR("stats request 0x%lx is not accessible by caller\n", (unsigned long)req);
+        sf[4] = -1;
+        return;
+    }
+
+    switch (req->op) {
+        case TMON_STATS_ENABLE:
+            ret = stats_enable(req->level, req->num);
+            break;
+        case TMON_STATS_READ:
+            num = (req->first < STATS_NUM) ? STATS_NUM - req->first : 0;
+            num = (req->num < num) ? req->num : num;
+            if ( !tmon_caller_access(s, (unsigned long)req->buf, num * sizeof(tmon_stat_t), 1) ) {
+                ERROR("stats buffer 0x%lx is not writable by caller\n", (unsigned long)req->buf);
+                ret = -1;
+                break;
+            }
+            ret = stats_read(req->level, req->first, num, req->buf);
+            if ( ret >= 0 ) {
+                sf[5] = ret;
+                ret   = 0;
+            }
+            break;
+        case TMON_STATS_RESET:
+            ret = stats_reset(req->level);
+            break;
+        case TMON_STATS_DUMP:
+            stats_dump();
+            ret = 0;
+            break;
+        default:
+            ret = -1;
+    }
+
+    sf[4] = ret;
+}
+
+
+/// @name   mmon_tpoint( *s )
+/// @brief  enable/disable tracepoint by id or name (patch its sites), dump
+///         hit counters and records, TMON_FID_TPOINT
+/// @return a0 = 0 - OK, -1 - unknown tracepoint, op or inaccessible name;
+///         a1 = patched sites
+static void mmon_tpoint(void *s) {
+
+    register unsigned long *sf    = (unsigned long *)s;
+    register tmon_tpoint_t *req   = (tmon_tpoint_t *)sf[5];     // in a1
+    register unsigned long  len;
+    register int            id;
+    register int            ret   = -1;
+
+    sf[5] = 0;
+
+    if ( !tmon_caller_access(s, (unsigned long)req, sizeof(*req), 0) ) {
+        ERROR("tracepoint request 0x%lx is not accessible by caller\n", (unsigned long)req);
+        sf[4] = -1;
+        return;
+    }
+
+    id = (int)req->id;
+
+    if ( req->name ) {
+
+        // name is read with M-mode privilege, every byte up to terminator
+        // has to be readable by caller
+
+        for (len = 0; tmon_caller_access(s, (unsigned long)req->name + len, 1, 0); len++)
+            if ( 0 == req->name[len] )
+                break;
+
+        if ( !tmon_caller_access(s, (unsigned long)req->name + len, 1, 0) ) {
+            ERROR("tracepoint name 0x%lx is not accessible by caller\n", (unsigned long)req->name);
+            sf[4] = -1;
+            return;
+        }
+
+        id = tpoint_lookup(req->name);
+    }
+
+    switch (req->op) {
+        case TMON_TPOINT_ENABLE:
+        case TMON_TPOINT_DISABLE:
+            if ( id >= 0 )
+                ret = tpoint_enable(id, TMON_TPOINT_ENABLE == req->op);
+            if ( ret >= 0 ) {
+                sf[5] = ret;
+                ret   = 0;
+            }
+            break;
+        case TMON_TPOINT_DUMP:
+            tpoint_dump();
+            ret = 0;
+            break;
+    }
+
+    sf[4] = ret;
+}
+
+
 /// @name   mmon_cb( *s )
 /// @brief  link/unlink user callback to the specified tmon trap handler
 /// @param
@@ -306,7 +764,13 @@ static void mmon_cb  (void *s) {
     register unsigned long *sf    = (unsigned long *)s;
     register unsigned long *cb    = (unsigned long *)sf[5];      // in a1
 
-    if (0 != cb[1]) {
+    if (cb[0] >= 96) {
+        // external interrupt beyond callback vector, trap id = 64 + eiid
+        TRACE("link user callback @0x%lx to M-mode external interrupt #%ld\n", cb[1], cb[0] - 64);
+        if ( 0 != m_ext_link(cb[0] - 64, 1, (void*)cb[1]) )
+            exit(-1);
+    }
+    else if (0 != cb[1]) {
         TRACE("link user callback @0x%lx to M-mode trap #%ld\n", cb[1], cb[0]);
         m_trap_callback[cb[0]] = (void*)cb[1];
     }
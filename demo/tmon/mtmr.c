@@ -0,0 +1,126 @@
+/// @file       mtmr.c
+/// @brief      RISC-V Test Monitor - M-mode timer driver (ACLINT MTIMER),
+///             M-mode code
+
+#include "arch/arch.h"
+#include "tmon.h"
+#include "mtvec.h"
+#include "mtmr.h"
+#include "cntr.h"
+
+
+#define MTIME_LO_REG        (__mmio_base[0xBFF8/4])
+#define MTIME_HI_REG        (__mmio_base[0xBFFC/4])
+#define MTIMECMP_LO_REG     (__mmio_base[0x4000/4])
+#define MTIMECMP_HI_REG     (__mmio_base[0x4004/4])
+
+#define MTIME_RD(__val__, __reg__)  ((__val__) = (__reg__))
+
+
+/* M-mode timer wheel */
+
+twheel_t m_twheel;
+
+
+/// @name   mtmr_time()
+/// @brief  consistent 64-bit mtime read on rv32
+u64_t mtmr_time(void) {
+
+    return CNTR_READ64_BY(MTIME_RD, MTIME_HI_REG, MTIME_LO_REG);
+}
+
+
+/// @name   mtmr_compare( cmp )
+/// @brief  program mtimecmp without spurious match, high part is parked
+///         at maximum while low part is written
+void mtmr_compare(u64_t cmp) {
+
+    MTIMECMP_HI_REG = ~0UL;
+    MTIMECMP_LO_REG = (unsigned long)cmp;
+    MTIMECMP_HI_REG = (unsigned long)(cmp >> 32);
+}
+
+
+/// @name   m_mtmr_handler( *s )
+/// @brief  M-mode timer interrupt handler, expires timers and programs
+///         mtimecmp for the nearest deadline (de-asserts MTIP)
+static void m_mtmr_handler(void *s) {
+
+    mtmr_compare( twheel_run(&m_twheel, mtmr_time(), s) );
+}
+
+
+/// @name   mtmr_init()
+/// @brief  empty timer wheel, install and enable MTMR handler (needs
+///         mtvec.MODE=0)
+int mtmr_init(void) {
+
+    register unsigned long mtvec;
+
+    __csrr(mtvec, CSR_MTVEC);
+
+    if ( mtvec & 0x03 ) {
+        WARNING("M-mode timer is not supported for mtvec.MODE=%ld\n", mtvec & 0x03);
+        return -1;
+    }
+
+    mtmr_compare(TWHEEL_NEVER);
+
+    twheel_init(&m_twheel, mtmr_time());
+
+    m_maj_setvec(TRAP_IID_MTMR, m_mtmr_handler);
+    m_maj_enable(TRAP_IID_MTMR, 1);
+
+    return 0;
+}
+
+
+/// @name   mtmr_start( *t, delay, period, fn, *arg )
+/// @brief  start one-shot (period is 0) or periodic timer, delay and period
+///         are mtime ticks. Running timer is restarted
+int mtmr_start(twheel_timer_t *t, u64_t delay, u64_t period, twheel_fn_t fn, void *arg) {
+
+    register unsigned long mie;
+
+    t->fn     = (fn) ? fn : (twheel_fn_t)m_trap_callback[32 + TRAP_IID_MTMR];
+    t->arg    = arg;
+    t->period = period;
+
+    if ( 0 == t->fn ) {
+        ERROR("no callback assigned to M-mode timer\n");
+        return -1;
+    }
+
+    __csrr(mie, CSR_MIE);                       // wheel is updated by handler
+    __csrc(CSR_MIE, 1 << TRAP_IID_MTMR);
+
+    t->expires = mtmr_time() + delay;
+
+    twheel_add(&m_twheel, t);
+
+    if ( 0 == m_twheel.current )
+        mtmr_compare( twheel_next(&m_twheel) ); // handler programs it otherwise
+
+    __csrs(CSR_MIE, mie & (1 << TRAP_IID_MTMR));
+
+    return 0;
+}
+
+
+/// @name   mtmr_stop( *t )
+/// @brief  stop pending timer, mtimecmp is left as is (early interrupt
+///         reprograms it)
+int mtmr_stop(twheel_timer_t *t) {
+
+    register unsigned long mie;
+    register int ret;
+
+    __csrr(mie, CSR_MIE);
+    __csrc(CSR_MIE, 1 << TRAP_IID_MTMR);
+
+    ret = twheel_del(&m_twheel, t);
+
+    __csrs(CSR_MIE, mie & (1 << TRAP_IID_MTMR));
+
+    return ret;
+}
@@ -0,0 +1,29 @@
+/// @file       mtmr.h
+/// @brief      RISC-V Test Monitor - M-mode timer driver (ACLINT MTIMER),
+///             M-mode code
+
+#pragma once
+
+
+/*
+    mtime/mtimecmp of hart 0 (MMIO region, __mmio_base + 0xBFF8/0x4000):
+
+    - mtmr_time() reads consistent 64-bit mtime on rv32 (CNTR_READ64_BY)
+    - timers are linked to M-mode timer wheel (twheel.c), mtimecmp is
+      programmed for the nearest deadline only, no periodic ticks
+    - timer callback has the trap callback signature, timer without
+      callback uses m_trap_callback[32 + TRAP_IID_MTMR] (TMON_FID_CB)
+    - MTMR handler is installed to M-mode trap vector (mtvec.MODE=0)
+*/
+
+#include "twheel.h"
+
+extern twheel_t m_twheel;
+
+extern u64_t mtmr_time   ( void );
+extern void  mtmr_compare( u64_t cmp );
+extern int   mtmr_init   ( void );
+extern int   mtmr_start  ( twheel_timer_t *t, u64_t delay, u64_t period, twheel_fn_t fn, void *arg );
+extern int   mtmr_stop   ( twheel_timer_t *t );
+
+#define mtmr_current()  (m_twheel.current)
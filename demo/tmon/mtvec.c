@@ -3,6 +3,7 @@
 
 #include "arch/arch.h"
 #include "tmon.h"
+#include "tpoint.h"
 
 /* M-mode trap wrappers */
 
@@ -153,6 +154,31 @@ void *m_trap_vector[96] = {
 
 void *m_trap_callback[96] = {};
 
+/* M-mode Sparse External Interrupt Table, two-level: EIID[10:5] selects 
+   block of 32 EIIDs, blocks are taken from static pool on registration,
+   so memory is proportional to the number of registered EIID blocks.
+   Handlers of EIIDs beyond m_trap_vector[] (eiid >= 32 for mtvec.MODE=0,
+   any eiid for mtvec.MODE=3) and callbacks for trap ids >= 96 (64 + eiid) */
+
+typedef struct m_ext_block_s {
+    void *handler[32];
+    void *callback[32];
+} m_ext_block_t;
+
+static m_ext_block_t *m_ext_table[M_EXT_EIID_NUM / 32];
+static m_ext_block_t  m_ext_pool[M_EXT_BLOCK_NUM];
+static unsigned long  m_ext_pool_used = 0;
+
+#define M_EXT_HANDLER(__eiid__)     \
+    ((m_ext_table[(__eiid__) >> 5]) ? m_ext_table[(__eiid__) >> 5]->handler[(__eiid__) & 0x1F] : 0)
+#define M_EXT_CALLBACK(__eiid__)    \
+    ((m_ext_table[(__eiid__) >> 5]) ? m_ext_table[(__eiid__) >> 5]->callback[(__eiid__) & 0x1F] : 0)
+
+/* M-mode Trap Delegation State (copy of medeleg/mideleg for S-mode monitor) */
+
+volatile unsigned long m_exc_deleg = 0;
+volatile unsigned long m_int_deleg = 0;
+
 
 /******************************************************************************
 ** M-mode default trap handlers 
@@ -218,11 +244,13 @@ static void m_ext_default(void *s) {
     register unsigned long *sf      = (unsigned long *)s;
     register unsigned long eiid     = sf[20];
     register unsigned long expect   = queue_pop();
+    void *cb;
 
     if ( (64 + (eiid >> 16)) == expect ) {
         TRACE("expected external interrupt trap eiid=%ld\n", eiid >> 16);
-        if ( 0 != m_trap_callback[expect] ) {
-            ((void (*)(void*s))(m_trap_callback[expect]))(s);   
+        cb = (expect < 96) ? m_trap_callback[expect] : M_EXT_CALLBACK(eiid >> 16);
+        if ( 0 != cb ) {
+            ((void (*)(void*s))(cb))(s);   
         }
         else {
             WARNING("default external interrupt handler with no user callback assigned to #%ld\n", expect);
@@ -242,8 +270,9 @@ static void m_ext_default(void *s) {
 void m_nvi_default(void *s) {
 
     register unsigned long *sf = (unsigned long *)s;
-    register unsigned long expect = queue_pop(); 
+    register unsigned long expect; 
     register unsigned long eiid; 
+    void *cb;
 
     __csrw(CSR_MISELECT, M_EI_THRESHOLD_REG);
     __csrrw(eiid, CSR_MIREG, 0);
@@ -251,10 +280,19 @@ void m_nvi_default(void *s) {
     sf[20] = eiid;              // store current eiid to the trap stack frame
                                 // and make it visible to the next level 
 
-    if ( (32 + eiid) == expect ) {
+    cb = M_EXT_HANDLER(eiid);
+    if ( 0 != cb ) {
+        return ((void (*)(void*))(cb))(s);      // registered with m_ext_setvec()
+    }
+
+    expect = queue_pop(); 
+
+    // EIIDs beyond IVT use trap id 64 + eiid (sparse table callbacks)
+    if ( ((eiid < 64) ? (32 + eiid) : (64 + eiid)) == expect ) {
         TRACE("expected external interrupt trap eiid=%ld\n", eiid);
-        if ( 0 != m_trap_callback[expect] ) {
-            ((void (*)(void*s))(m_trap_callback[expect]))(s);   
+        cb = (expect < 96) ? m_trap_callback[expect] : M_EXT_CALLBACK(eiid);
+        if ( 0 != cb ) {
+            ((void (*)(void*s))(cb))(s);   
         }
         else {
             WARNING("default external interrupt handler with no user callback assigned to #%ld\n", expect);
@@ -276,14 +314,20 @@ static void m_maj_ext_wrapper(void *s) {
 
     register unsigned long *sf      = (unsigned long *)s;
     register unsigned long topei;
+    void *handler;
 
     // read top eiid and claim it
     asm volatile ("csrrw %0, mtopei, zero" : "=r"(topei) :: );
 
     sf[20] = topei;     // store topei to the trap stack frame, 
                         // so it is visible at the next level 
- 
-    return ((void (*)(void*))(m_trap_vector[64 + (topei >> 16)]))(s);
+
+    if ( (topei >> 16) < 32 )
+        return ((void (*)(void*))(m_trap_vector[64 + (topei >> 16)]))(s);
+
+    handler = M_EXT_HANDLER(topei >> 16);
+
+    return ((void (*)(void*))((handler) ? handler : (void*)m_ext_default))(s);
 
 }
 
@@ -326,6 +370,8 @@ static void m_exc_fetch_fault(void *s ) {
 
     __csrr(tval, CSR_MTVAL);
 
+    TPOINT(TP_M_FAULT, sf[18], tval);
+
     if ( 12 == queue_pop() ) {
 
         TRACE("expected instruction fetch fault @0x%lx\n", tval);
@@ -349,6 +395,8 @@ static void m_exc_load_fault (void *s ) {
 
     __csrr(tval, CSR_MTVAL);
 
+    TPOINT(TP_M_FAULT, sf[18], tval);
+
     if ( 13 == queue_pop() ) {
 
         TRACE("expected data load fault @0x%lx\n", tval);
@@ -372,6 +420,8 @@ static void m_exc_cross_fault(void *s ) {
 
     __csrr(tval, CSR_MTVAL);
 
+    TPOINT(TP_M_FAULT, sf[18], tval);
+
     if ( 14 == queue_pop() ) {
 
         TRACE("expected SMPU region crossing fault @0x%lx\n", tval);
@@ -396,6 +446,8 @@ static void m_exc_store_fault(void *s ) {
 
     __csrr(tval, CSR_MTVAL);
 
+    TPOINT(TP_M_FAULT, sf[18], tval);
+
     if ( 15 == queue_pop() ) {
 
         TRACE("expected data store fault @0x%lx\n", tval);
@@ -511,11 +563,14 @@ int m_ext_setvec(int eiid, void *handler) {
 
     switch (mtvec & 0x03) {
         case 0:
-            m_trap_vector[32 + 32 + eiid] = handler;
-            break;
-        case 1:
-        // not yet supported
+            if (eiid < 32) {
+                m_trap_vector[32 + 32 + eiid] = handler;
+                break;
+            }
+            return m_ext_link(eiid, 0, handler);
         case 3:
+            return m_ext_link(eiid, 0, handler);
+        case 1:
         // not yet supported
         default:
             WARNING("not yet implemented\n");
@@ -526,6 +581,44 @@ int m_ext_setvec(int eiid, void *handler) {
 }
 
 
+/// @name   m_ext_link(eiid, callback, *ptr)
+/// @brief  set handler (callback = 0) or user callback (callback = 1) of 
+///         EIID in the sparse external interrupt table, block of 32 EIIDs
+///         is allocated on the first registration
+int m_ext_link(unsigned long eiid, int callback, void *ptr) {
+
+    m_ext_block_t *blk;
+
+    if ( eiid >= M_EXT_EIID_NUM ) {
+        ERROR("external interrupt #%ld is out of range\n", eiid);
+        return -1;
+    }
+
+    blk = m_ext_table[eiid >> 5];
+
+    if ( 0 == blk ) {
+
+        if ( 0 == ptr )
+            return 0;                   // nothing to unlink
+
+        if ( m_ext_pool_used >= M_EXT_BLOCK_NUM ) {
+            ERROR("no free sparse table block for external interrupt #%ld\n", eiid);
+            return -1;
+        }
+
+        blk = &m_ext_pool[m_ext_pool_used++];
+        m_ext_table[eiid >> 5] = blk;
+    }
+
+    if (callback)
+        blk->callback[eiid & 0x1F] = ptr;
+    else
+        blk->handler[eiid & 0x1F] = ptr;
+
+    return 0;
+}
+
+
 /// @name   m_exc_delegate(eid, delegate)
 /// @brief  enable/disable M-mode exception trap delegation
 int m_exc_delegate(int eid, int delegate) {
@@ -536,6 +629,8 @@ int m_exc_delegate(int eid, int delegate) {
     else
         __csrc(CSR_MEDELEG, (1 << eid));
 
+    __csrr(m_exc_deleg, CSR_MEDELEG);
+
     return 0;
 }
 
@@ -555,6 +650,8 @@ int m_maj_delegate(int iid, int delegate) {
         else 
             __csrc(CSR_MIDELEGH, 1 << (iid >> 1));
 
+    __csrr(m_int_deleg, CSR_MIDELEG);
+
     return 0;
 }
 
@@ -0,0 +1,207 @@
+/// @file       pmu.c
+/// @brief      RISC-V Test Monitor - hardware performance monitor driver
+///             (mhpmcounter/mhpmevent, Sscofpmf overflow sampling), M-mode code
+
+#include "arch/arch.h"
+#include "tmon.h"
+#include "mtvec.h"
+#include "pmu.h"
+#include "cntr.h"
+
+
+/* counter number to CSR number, csrr/csrw need immediate CSR numbers */
+
+#define PMU_CTR_LIST(X, __b__)  \
+    X( 3, __b__) X( 4, __b__) X( 5, __b__) X( 6, __b__) X( 7, __b__) X( 8, __b__) X( 9, __b__) \
+    X(10, __b__) X(11, __b__) X(12, __b__) X(13, __b__) X(14, __b__) X(15, __b__) X(16, __b__) \
+    X(17, __b__) X(18, __b__) X(19, __b__) X(20, __b__) X(21, __b__) X(22, __b__) X(23, __b__) \
+    X(24, __b__) X(25, __b__) X(26, __b__) X(27, __b__) X(28, __b__) X(29, __b__) X(30, __b__) \
+    X(31, __b__)
+
+#define PMU_CSRW_CASE(__n__, __b__) case __n__: __csrw((__b__) + (__n__) - 3, val); break;
+#define PMU_CSRR_CASE(__n__, __b__) case __n__: __csrr(val, (__b__) + (__n__) - 3); break;
+
+#define PMU_CSRW(__b__, __ctr__, __val__)   \
+    do { register unsigned long val = (__val__); switch (__ctr__) { PMU_CTR_LIST(PMU_CSRW_CASE, __b__) } } while (0)
+
+#define PMU_CSRR(__b__, __ctr__)            \
+    ({ register unsigned long val = 0; switch (__ctr__) { PMU_CTR_LIST(PMU_CSRR_CASE, __b__) } val; })
+
+#define PMU_RD(__val__, __b__)  ((__val__) = PMU_CSRR(__b__, ctr))      // CNTR_READ64_BY() reader, ctr in scope
+
+#define PMU_CTR_VALID(__ctr__)  ((__ctr__) >= PMU_CTR_FIRST && (__ctr__) <= PMU_CTR_LAST)
+
+
+/* sample buffer */
+
+pmu_buf_t pmu_buf;
+
+
+/// @name   pmu_event( ctr, event, inh )
+/// @brief  select counter event (implementation defined) and inhibited
+///         privilege modes (PMU_INH_x), overflow flag is cleared
+int pmu_event(int ctr, unsigned long event, unsigned long inh) {
+
+    if ( !PMU_CTR_VALID(ctr) ) {
+        ERROR("invalid performance counter %d\n", ctr);
+        return -1;
+    }
+
+    pmu_buf.inh[ctr] = inh & (PMU_INH_M | PMU_INH_S | PMU_INH_U | PMU_INH_VS | PMU_INH_VU);
+
+    PMU_CSRW(CSR_MHPMEVENT3,  ctr, event);
+    PMU_CSRW(CSR_MHPMEVENTH3, ctr, pmu_buf.inh[ctr]);
+
+    return 0;
+}
+
+
+/// @name   pmu_preload( ctr, period )
+/// @brief  load counter with -period (overflow after period events) and clear
+///         overflow flag, counter is inhibited while written
+int pmu_preload(int ctr, unsigned long period) {
+
+    register unsigned long inhibit;
+
+    if ( !PMU_CTR_VALID(ctr) || (0 == period) ) {
+        ERROR("invalid performance counter %d or period %lu\n", ctr, period);
+        return -1;
+    }
+
+    __csrr(inhibit, CSR_MCOUNTINHIBIT);
+    __csrs(CSR_MCOUNTINHIBIT, 1UL << ctr);
+
+    PMU_CSRW(CSR_MHPMCOUNTER3,  ctr, 0);        // no carry to high part
+    PMU_CSRW(CSR_MHPMCOUNTERH3, ctr, ~0UL);
+    PMU_CSRW(CSR_MHPMCOUNTER3,  ctr, 0UL - period);
+    PMU_CSRW(CSR_MHPMEVENTH3,   ctr, pmu_buf.inh[ctr]);
+
+    __csrc(CSR_MCOUNTINHIBIT, ~inhibit & (1UL << ctr));
+
+    return 0;
+}
+
+
+/// @name   pmu_read( ctr )
+/// @brief  consistent 64-bit counter read on rv32
+u64_t pmu_read(int ctr) {
+
+    if ( !PMU_CTR_VALID(ctr) )
+        return 0;
+
+    return CNTR_READ64_BY(PMU_RD, CSR_MHPMCOUNTERH3, CSR_MHPMCOUNTER3);
+}
+
+
+/// @name   pmu_start( mask )
+/// @brief  start counters of mask (mcountinhibit bits)
+void pmu_start(unsigned long mask) {
+
+    __csrc(CSR_MCOUNTINHIBIT, mask);
+}
+
+
+/// @name   pmu_stop( mask )
+/// @brief  stop counters of mask (mcountinhibit bits)
+void pmu_stop(unsigned long mask) {
+
+    __csrs(CSR_MCOUNTINHIBIT, mask);
+}
+
+
+/// @name   m_pmu_handler( *s )
+/// @brief  counter overflow interrupt handler, records sample for every
+///         overflowed sampling counter and preloads it again (clears OF,
+///         de-asserts LCOFIP)
+static void m_pmu_handler(void *s) {
+
+    register unsigned long *sf = s;
+    register unsigned long  ovf;
+    register int            ctr;
+
+    __csrr(ovf, CSR_SCOUNTOVF);
+
+    ovf &= pmu_buf.mask;
+
+    for (ctr = PMU_CTR_FIRST; ctr <= PMU_CTR_LAST; ctr++) {
+
+        if ( 0 == (ovf & (1UL << ctr)) )
+            continue;
+
+        if ( pmu_buf.num < PMU_SAMPLE_NUM ) {
+            pmu_buf.sample[pmu_buf.num].epc   = sf[17];
+            pmu_buf.sample[pmu_buf.num].cause = ctr;
+            pmu_buf.num++;
+        } else {
+            pmu_buf.drops++;
+        }
+
+        pmu_preload(ctr, pmu_buf.period[ctr]);
+    }
+
+    __csrc(CSR_MIP, 1 << TRAP_IID_COV);
+}
+
+
+/// @name   pmu_sample( ctr, event, inh, period )
+/// @brief  program counter for overflow sampling every period events, install
+///         and enable LCOFI handler (needs mtvec.MODE=0). Counter is left
+///         stopped, sampling runs from pmu_start()
+int pmu_sample(int ctr, unsigned long event, unsigned long inh, unsigned long period) {
+
+    register unsigned long mtvec;
+
+    __csrr(mtvec, CSR_MTVEC);
+
+    if ( mtvec & 0x03 ) {
+        WARNING("PMU sampling is not supported for mtvec.MODE=%ld\n", mtvec & 0x03);
+        return -1;
+    }
+
+    if ( !PMU_CTR_VALID(ctr) || (0 == period) ) {
+        ERROR("invalid performance counter %d or period %lu\n", ctr, period);
+        return -1;
+    }
+
+    pmu_stop(1UL << ctr);
+
+    pmu_event(ctr, event, inh);
+
+    pmu_buf.period[ctr] = period;
+    pmu_buf.mask       |= 1UL << ctr;
+
+    pmu_preload(ctr, period);
+
+    m_maj_setvec(TRAP_IID_COV, m_pmu_handler);
+    m_maj_enable(TRAP_IID_COV, 1);
+
+    return 0;
+}
+
+
+/// @name   pmu_reset()
+/// @brief  stop sampling counters and empty sample buffer
+void pmu_reset(void) {
+
+    pmu_stop(pmu_buf.mask);
+
+    m_maj_enable(TRAP_IID_COV, 0);
+
+    pmu_buf.mask  = 0;
+    pmu_buf.num   = 0;
+    pmu_buf.drops = 0;
+}
+
+
+/// @name   pmu_dump()
+/// @brief  print samples, one "pmu: <epc> <cause>" line per sample
+///         (tools/pmu_hist.py input)
+void pmu_dump(void) {
+
+    register unsigned long i;
+
+    printf("pmu: samples %lu, dropped %lu\n", pmu_buf.num, pmu_buf.drops);
+
+    for (i = 0; i < pmu_buf.num; i++)
+        printf("pmu: 0x%lx %lu\n", pmu_buf.sample[i].epc, pmu_buf.sample[i].cause);
+}
@@ -0,0 +1,60 @@
+/// @file       pmu.h
+/// @brief      RISC-V Test Monitor - hardware performance monitor driver
+///             (mhpmcounter/mhpmevent, Sscofpmf overflow sampling), M-mode code
+
+
+/*
+    Programmable counters 3..31:
+
+    - pmu_event() selects event (implementation defined) and privilege
+      modes which are not counted (PMU_INH_x)
+    - pmu_preload() loads counter with -period, so it overflows after
+      period events (mhpmeventh.OF is cleared)
+    - pmu_sample() programs counter for overflow sampling, every counter
+      overflow interrupt (LCOFI, TRAP_IID_COV) records (mepc, cause) to
+      pmu_buf and preloads the counter again, cause is the overflowed
+      counter number. Samples are dropped when the buffer is full
+    - pmu_dump() prints samples for tools/pmu_hist.py (per-function
+      histogram from ELF symbols)
+
+    LCOFI handler is installed to M-mode trap vector (mtvec.MODE=0),
+    sampled code runs with M-mode interrupts enabled or in lower modes.
+*/
+
+#ifndef PMU_SAMPLE_NUM
+#define PMU_SAMPLE_NUM      512
+#endif
+
+#define PMU_CTR_FIRST       3
+#define PMU_CTR_LAST        31
+
+#define PMU_INH_M           (1UL << CSR_MHPMEVENTH_MINH_BIT)
+#define PMU_INH_S           (1UL << CSR_MHPMEVENTH_SINH_BIT)
+#define PMU_INH_U           (1UL << CSR_MHPMEVENTH_UINH_BIT)
+#define PMU_INH_VS          (1UL << CSR_MHPMEVENTH_VSINH_BIT)
+#define PMU_INH_VU          (1UL << CSR_MHPMEVENTH_VUINH_BIT)
+
+typedef struct pmu_sample_s {
+    unsigned long   epc;            // interrupted PC
+    unsigned long   cause;          // overflowed counter
+} pmu_sample_t;
+
+typedef struct pmu_buf_s {
+    unsigned long   num;            // recorded samples
+    unsigned long   drops;          // samples dropped on full buffer
+    unsigned long   mask;           // sampling counters
+    unsigned long   period[32];     // sampling period of counter
+    unsigned long   inh[32];        // mhpmeventh inhibit bits of counter
+    pmu_sample_t    sample[PMU_SAMPLE_NUM];
+} pmu_buf_t;
+
+extern pmu_buf_t pmu_buf;
+
+extern int   pmu_event  ( int ctr, unsigned long event, unsigned long inh );
+extern int   pmu_preload( int ctr, unsigned long period );
+extern u64_t pmu_read   ( int ctr );
+extern void  pmu_start  ( unsigned long mask );
+extern void  pmu_stop   ( unsigned long mask );
+extern int   pmu_sample ( int ctr, unsigned long event, unsigned long inh, unsigned long period );
+extern void  pmu_reset  ( void );
+extern void  pmu_dump   ( void );
@@ -0,0 +1,83 @@
+/// @file       prof.c
+/// @brief      RISC-V Test Monitor - timer-driven statistical PC sampling
+///             profiler, M-mode code
+
+#include "arch/arch.h"
+#include "tmon.h"
+#include "mtmr.h"
+#include "prof.h"
+
+
+/* sample buffer and sampling timer */
+
+prof_buf_t prof_buf;
+
+static twheel_timer_t prof_timer;
+
+
+/// @name   prof_tick( *s )
+/// @brief  sampling timer callback, records interrupted context
+static void prof_tick(void *s) {
+
+    register unsigned long *sf = (unsigned long *)s;
+    register prof_sample_t *p;
+
+    if ( prof_buf.num >= PROF_SAMPLE_NUM ) {
+        prof_buf.drops++;
+        return;
+    }
+
+    p = &prof_buf.sample[prof_buf.num++];
+
+    p->epc  = sf[17];
+    p->ra   = sf[0];
+    p->priv = ((sf[16] & CSR_MSTATUS_MPP_MASK)  >> CSR_MSTATUS_MPP_SHIFT) |
+              ((sf[19] & CSR_MSTATUSH_MPV_MASK) >> CSR_MSTATUSH_MPV_SHIFT) << 2;
+}
+
+
+/// @name   prof_start( interval )
+/// @brief  empty sample buffer and start sampling every interval mtime ticks
+int prof_start(unsigned long interval) {
+
+    if ( 0 == interval ) {
+        ERROR("invalid sampling interval\n");
+        return -1;
+    }
+
+    prof_buf.num      = 0;
+    prof_buf.drops    = 0;
+    prof_buf.interval = interval;
+
+    return mtmr_start(&prof_timer, interval, interval, prof_tick, &prof_buf);
+}
+
+
+/// @name   prof_stop()
+/// @brief  stop sampling, samples are kept until the next prof_start()
+int prof_stop(void) {
+
+    return mtmr_stop(&prof_timer);
+}
+
+
+/// @name   prof_flush()
+/// @brief  print samples through the host link, one "prof: <priv> <epc> <ra>"
+///         line per sample (tools/prof_fold.py input). Buffer is emptied
+void prof_flush(void) {
+
+    register unsigned long i;
+
+    if ( 0 == prof_buf.num && 0 == prof_buf.drops )
+        return;
+
+    printf("prof: samples %lu, dropped %lu, interval %lu\n",
+            prof_buf.num, prof_buf.drops, prof_buf.interval);
+
+    for (i = 0; i < prof_buf.num; i++)
+        printf("prof: %lu 0x%lx 0x%lx\n",
+                prof_buf.sample[i].priv, prof_buf.sample[i].epc, prof_buf.sample[i].ra);
+
+    prof_buf.num   = 0;
+    prof_buf.drops = 0;
+}
@@ -0,0 +1,44 @@
+/// @file       prof.h
+/// @brief      RISC-V Test Monitor - timer-driven statistical PC sampling
+///             profiler, M-mode code
+
+
+/*
+    Periodic M-mode timer (mtmr.c) samples the interrupted context:
+
+    - every tick records mepc (sf[17]), ra (sf[0]) and privilege mode
+      (mstatus.MPP | mstatush.MPV << 2, the same encoding as M_MODE,
+      S_MODE, VS_MODE ...) to the preallocated prof_buf, the timer is
+      re-armed by the timer wheel (periodic timer)
+    - samples beyond PROF_SAMPLE_NUM are counted as dropped
+    - prof_flush() prints samples through the host link, monitor exit
+      request (TMON_FID_EXIT) flushes pending samples
+    - tools/prof_fold.py folds the log to flat profile and collapsed stacks
+      (ra gives the caller of leaf functions)
+
+    mtmr_init() has to be called before prof_start() (mtvec.MODE=0), code
+    running in M-mode is sampled only with M-mode interrupts enabled.
+*/
+
+#ifndef PROF_SAMPLE_NUM
+#define PROF_SAMPLE_NUM     1024
+#endif
+
+typedef struct prof_sample_s {
+    unsigned long   epc;            // interrupted PC
+    unsigned long   ra;             // return address (caller of leaf function)
+    unsigned long   priv;           // MPV << 2 | MPP
+} prof_sample_t;
+
+typedef struct prof_buf_s {
+    unsigned long   num;            // recorded samples
+    unsigned long   drops;          // samples dropped on full buffer
+    unsigned long   interval;       // mtime ticks
+    prof_sample_t   sample[PROF_SAMPLE_NUM];
+} prof_buf_t;
+
+extern prof_buf_t prof_buf;
+
+extern int  prof_start( unsigned long interval );
+extern int  prof_stop ( void );
+extern void prof_flush( void );
@@ -1,50 +1,86 @@
-/// @file   mmon.c
-/// @brief  RISC-V Test Monitor - M-mode Monitor Services
+/// @file   smon.c
+/// @brief  RISC-V Test Monitor - S-mode Monitor Services
 
+#include "arch/arch.h"
 #include "tmon.h"
+#include "work.h"
 
 typedef void (*smon_fid_t)(void *s);
 
-static void smon_fail(void *s);
-static void smon_exit(void *s);
-static void smon_priv(void *s);
+static void smon_fail  (void *s);
+static void smon_exit  (void *s);
+static void smon_priv  (void *s);
+static void smon_expect(void *s);
+static void smon_verify(void *s);
+static void smon_sswi  (void *s);
+static void smon_smsi  (void *s);
+static void smon_cb    (void *s);
+static void smon_gmsi  (void *s);
+static void smon_bmsi  (void *s);
 static void smon_forward(void *s);
 
 static smon_fid_t s_fid_vector[] = {
     smon_fail,          // FID=0  - TMON_FID_FAIL
-    smon_exit,          // FID=1  - TMON_FID_EXIT 
+    smon_exit,          // FID=1  - TMON_FID_EXIT
     smon_forward,       // FID=2  - TMON_FID_CSRR
     smon_forward,       // FID=3  - TMON_FID_CSRW
     smon_forward,       // FID=4  - TMON_FID_CSRS
     smon_forward,       // FID=5  - TMON_FID_CSRC
-    smon_forward,       // FID=6  - TMON_FID_ICSRR 
+    smon_forward,       // FID=6  - TMON_FID_ICSRR
     smon_forward,       // FID=7  - TMON_FID_ICSRW
-    smon_forward,       // FID=8  - TMON_FID_ICSRS 
+    smon_forward,       // FID=8  - TMON_FID_ICSRS
     smon_forward,       // FID=9  - TMON_FID_ICSRC
     smon_priv,          // FID=10 - TMON_FID_PRIV
-    smon_forward,       // FID=11 - TMON_FID_EXPECT
-    smon_forward,       // FID=12 - TMON_FID_VERIFY
+    smon_expect,        // FID=11 - TMON_FID_EXPECT
+    smon_verify,        // FID=12 - TMON_FID_VERIFY
     smon_forward,       // FID=13 - TMON_FID_MSWI
-    smon_forward,       // FID=14 - TMON_FID_SSWI
+    smon_sswi,          // FID=14 - TMON_FID_SSWI
     smon_forward,       // FID=15 - TMON_FID_MMSI
-    smon_forward,       // FID=16 - TMON_FID_SMSI
+    smon_smsi,          // FID=16 - TMON_FID_SMSI
+    smon_cb,            // FID=17 - TMON_FID_CB
+    smon_priv,          // FID=18 - TMON_FID_QPRIV
+    smon_gmsi,          // FID=19 - TMON_FID_GMSI
+    smon_forward,       // FID=20 - TMON_FID_APLIC
+    smon_bmsi,          // FID=21 - TMON_FID_BMSI
+    smon_forward,       // FID=22 - TMON_FID_STATS
+    smon_forward,       // FID=23 - TMON_FID_TPOINT
 };
 
 
+/// @name  smon_is_local( trap_id )
+/// @brief check if trap is delegated to S-mode, so it is served by S-mode monitor
+///        external interrupts are S-level (S-mode IMSIC) ones if SEI is delegated
+static int smon_is_local(unsigned long trap_id) {
+
+    if (trap_id < 32)
+        return (m_exc_deleg >> trap_id) & 1;
+    if (trap_id < 64)
+        return (m_int_deleg >> (trap_id - 32)) & 1;
+
+    return (m_int_deleg >> TRAP_IID_SEXT) & 1;
+}
+
+
 /// @name  void s_exc_ecall( *s )
 /// @brief test monitor S-mode environment call exception trap entry point
 void s_exc_ecall(void *s ) {
 
     register unsigned long *sf = (unsigned long *)s;
     fid_t fid = (fid_t)(sf[4]);
-        
+
+    if ( fid >= sizeof(s_fid_vector) / sizeof(s_fid_vector[0]) ) {
+        ERROR("Unsupported S-mode ecall FID=%ld\n", sf[4]);
+        TRACE("pc: 0x%lx; status: %lx;\n", sf[17], sf[16] );
+        exit(-1);
+    }
+
     s_fid_vector[fid](s);
 
-    ERROR("Unsupported S-mode ecall exception trap.\n");
-    TRACE("pc: 0x%lx; status: %lx;\n", sf[17], sf[16] );
-    exit(-1);
+    sf[17] += 4;        // move EPC to the next (after ecall) instruction
 
-    sf[17] += 4;        // move EPC to the next (after ecall) instruction   
+    if ( WORK_TRIGGER_EXIT == s_work.trigger ) {
+        work_run(&s_work, s);               // monitor exit point, bottom-halves
+    }
 
     return;
 }
@@ -75,16 +111,209 @@ static void smon_exit(void *s) {
 }
 
 
-/// @name
-/// @brief
+/// @name   smon_priv( *s )
+/// @brief  S/HS-mode version of privilege switch FID handler. Downward and 
+///         S-level transitions (U, S, VU, VS) update sstatus.SPP/hstatus.SPV
+///         and return with sret, M-mode target is passed to S-mode trap 
+///         wrapper, which leaves the trap through M-mode monitor (stwr0.S)
 static void smon_priv(void *s) {
 
     register unsigned long *sf = (unsigned long *)s;
 
-    // not yet implemented
-    ERROR("switching privilege from delegated S-mode trap is not implemented yet\n");
-    exit(-1);
+    unsigned long status  = sf[16];                 // sstatus
+    unsigned long next    = (unsigned long)(sf[5]); // a1: next privilege & virtualization mode
+    unsigned long epc, vsstatus;
+
+    if ( next & TMON_PRIV_RESUME ) {
+
+        // exit of VS-level trap wrapper (vtwr0.S): continue at vsepc with
+        // vsstatus.SIE restored, caller's a1 is returned unchanged
+
+        next  &= ~TMON_PRIV_RESUME;
+        sf[5]  = next;
+
+        __csrr(epc, CSR_VSEPC);
+        __csrr(vsstatus, CSR_VSSTATUS);
+        __csrs(CSR_VSSTATUS, (vsstatus >> CSR_xSTATUS_SPIE_BIT & 1) << CSR_xSTATUS_SIE_BIT);
+
+        sf[17] = epc - 4;                           // s_exc_ecall() moves EPC past ecall
+    }
+
+    switch ( next ) {
+        case 0x00:
+        case 0x01:
+        case 0x04:
+        case 0x05:
+            break;
+        case 0x03:
+            sf[21] = sf[4];                         // request exit to M-mode (PRIV/QPRIV FID)
+            sf[4]  = 0;
+            return;
+        default:
+            ERROR("target privilege mode specification {%ld} is invalid\n", next);
+            exit(-1);
+    }
+
+    // update privilege mode stack in sstatus value and hstatus
+    sf[16] = (status & ~CSR_SSTATUS_SPP_MASK) | ((next & 0x01) << CSR_SSTATUS_SPP_SHIFT);
+
+    if (next >> 2)
+        __csrs(CSR_HSTATUS, CSR_HSTATUS_SPV_MASK);
+    else
+        __csrc(CSR_HSTATUS, CSR_HSTATUS_SPV_MASK);
+
+    sf[4] = 0;          // OK in a0
+}
+
+
+/// @name   smon_expect( *s )
+/// @brief  set expectation of specified trap, delegated traps are
+///         queued locally, others are forwarded to M-mode
+static void smon_expect(void *s) {
+
+    register unsigned long *sf      = (unsigned long *)s;
+    register unsigned long trap_id  = sf[5];
+
+    if ( !smon_is_local(trap_id) ) {
+        return smon_forward(s);
+    }
+
+    TRACE("expect S-mode trap #%ld\n", trap_id);
+
+    s_queue_append(trap_id);
+
+    sf[4] = 0;      // OK
+}
+
+
+/// @name   smon_verify( *s )
+/// @brief  verify that expected S-mode traps had been raised,
+///         M-mode expectations are verified by M-mode monitor
+static void smon_verify(void *s) {
+
+    if ( 0 != s_queue_is_empty() ) {
+        ERROR("expected S-mode trap queue is not empty\n");
+        exit(-1);
+    }
+
+    smon_forward(s);
+}
 
+
+/// @name   smon_sswi( *s )
+/// @brief  assert/de-assert S-mode SWI (Sswi MMIO register)
+static void smon_sswi(void *s) {
+
+    register unsigned long *sf      = (unsigned long *)s;
+    register unsigned long enable   = sf[5];
+
+    __mmio_base[0xC000/4] = (enable) ? 1 : 0;
+
+    sf[4] = 0;      // OK
+}
+
+
+/// @name   smon_smsi( *s )
+/// @brief  send S-mode MSI interrupt (S-mode IMSIC interrupt file)
+static void smon_smsi(void *s) {
+
+    register unsigned long *sf    = (unsigned long *)s;
+    register unsigned long eiid   = sf[5];      // in a1
+
+    __smsi_base[0] = eiid;
+
+    sf[4] = 0;      // OK
+}
+
+
+/// @name   smon_gmsi( *s )
+/// @brief  send MSI to IMSIC guest interrupt file (guest files belong to
+///         HS-mode), or assert/de-assert VS external interrupt with 
+///         hvip.VSEIP (guest file 0, software injection), see tmon_gmsi()
+static void smon_gmsi(void *s) {
+
+    register unsigned long *sf    = (unsigned long *)s;
+
+    sf[4] = tmon_gmsi(sf[5]);                           // in a1
+}
+
+
+/// @name   smon_bmsi( *s )
+/// @brief  send burst of S-mode MSIs (S-level IMSIC file), M-level 
+///         bursts are forwarded to M-mode
+/// @return a0 = 0 - OK, -1 - invalid burst or request; a1 = number of sent MSIs
+static void smon_bmsi(void *s) {
+
+    register unsigned long *sf    = (unsigned long *)s;
+    register tmon_bmsi_t   *req   = (tmon_bmsi_t *)sf[5];       // in a1
+    register unsigned long  i;
+
+    if ( !tmon_s_caller_access(s, (unsigned long)req, sizeof(*req), 0) ) {
+        ERROR("burst MSI request 0x%lx is not accessible by caller\n", (unsigned long)req);
+        sf[4] = -1;
+        sf[5] = 0;
+        return;
+    }
+
+    if ( TMON_BMSI_S != req->level ) {
+        return smon_forward(s);
+    }
+
+    if ( req->num > TMON_BMSI_MAX ||
+         (req->list && !tmon_s_caller_access(s, (unsigned long)req->list, req->num * sizeof(long), 0)) ) {
+        ERROR("burst of %ld MSIs is invalid or not accessible by caller\n", req->num);
+        sf[4] = -1;
+        sf[5] = 0;
+        return;
+    }
+
+    if (req->list)
+        for (i = 0; i < req->num; i++)
+            __smsi_base[0] = req->list[i];
+    else
+        for (i = 0; i < req->num; i++)
+            __smsi_base[0] = req->first + i;
+
+    sf[4] = 0;          // OK
+    sf[5] = req->num;
+}
+
+
+/// @name   smon_cb( *s )
+/// @brief  link/unlink user callback to the specified S-mode trap handler,
+///         callbacks for not delegated traps are forwarded to M-mode
+/// @return a0 = 0 - OK, -1 - inaccessible request or trap beyond callback vector
+static void smon_cb(void *s) {
+
+    register unsigned long *sf    = (unsigned long *)s;
+    register unsigned long *cb    = (unsigned long *)sf[5];      // in a1
+
+    if ( !tmon_s_caller_access(s, (unsigned long)cb, 2 * sizeof(long), 0) ) {
+        ERROR("callback request 0x%lx is not accessible by caller\n", (unsigned long)cb);
+        sf[4] = -1;
+        return;
+    }
+
+    if ( !smon_is_local(cb[0]) ) {
+        return smon_forward(s);
+    }
+
+    if (cb[0] >= 96) {
+        ERROR("S-mode trap #%ld is beyond callback vector\n", cb[0]);
+        sf[4] = -1;
+        return;
+    }
+
+    if (0 != cb[1]) {
+        TRACE("link user callback @0x%lx to S-mode trap #%ld\n", cb[1], cb[0]);
+        s_trap_callback[cb[0]] = (void*)cb[1];
+    }
+    else {
+        TRACE("unlink user callback from S-mode trap #%ld\n", cb[0]);
+        s_trap_callback[cb[0]] = (void*)0;
+    }
+
+    sf[4] = 0;      // OK
 }
 
 
@@ -94,7 +323,11 @@ static void smon_forward(void *s) {
 
     register unsigned long *sf = (unsigned long *)s;
 
-    TRACE("S-mode forwards ecall(0x%lx, 0x%lx) to M-mode\n", sf[4], sf[5]);
+    register unsigned long a0 asm ("a0") = sf[4];
+    register unsigned long a1 asm ("a1") = sf[5];
+
+    asm volatile ( "ecall \n" : "+r"(a0), "+r"(a1) : : "memory" );
 
-    tmon_call(sf[4], sf[5]); 
+    sf[4] = a0;     // pass M-mode monitor results back to the caller
+    sf[5] = a1;
 }
@@ -0,0 +1,177 @@
+/// @file       stats.c
+/// @brief      RISC-V Test Monitor - per-cause trap statistics, M-mode and
+///             S-mode code
+
+#include "arch/arch.h"
+#include "tmon.h"
+#include "stats.h"
+
+
+/* M-mode and S-mode tables */
+
+unsigned long m_stats_on = 0;
+tmon_stat_t   m_stats[STATS_NUM];
+
+unsigned long s_stats_on = 0;
+tmon_stat_t   s_stats[STATS_NUM];
+
+
+#define STATS_EIID(__eiid__)    (64 + (((__eiid__) < STATS_EIID_NUM) ? (__eiid__) : STATS_EIID_NUM - 1))
+#define STATS_CAUSE(__cause__)  ((((long)(__cause__) < 0) ? 32 : 0) + ((__cause__) & 0x1F))
+
+
+/// @name   stats_add( *st, cycles )
+/// @brief  account one trap
+static inline void stats_add(tmon_stat_t *st, unsigned long cycles) {
+
+    if ( 0 == st->count || cycles < st->min )
+        st->min = cycles;
+    if ( cycles > st->max )
+        st->max = cycles;
+
+    st->sum += cycles;
+    st->count++;
+}
+
+
+/// @name   m_stats_trap( *s )
+/// @brief  M-mode trap wrapper exit, trap id from mcause (sf[18]), EIID of
+///         MEXT from topei (sf[20], mtvec.MODE=0)
+void m_stats_trap(void *s) {
+
+    register unsigned long *sf = (unsigned long *)s;
+    register unsigned long  cycle;
+
+    __csrr(cycle, CSR_MCYCLE);
+
+    if ( 0 == m_stats_on )
+        return;
+
+    cycle -= sf[22];
+
+    stats_add(&m_stats[STATS_CAUSE(sf[18])], cycle);
+
+    if ( (32 + TRAP_IID_MEXT) == STATS_CAUSE(sf[18]) )
+        stats_add(&m_stats[STATS_EIID(sf[20] >> 16)], cycle);
+}
+
+
+/// @name   m_stats_nvi( *s )
+/// @brief  M-mode nested interrupt wrapper exit, EIID from sf[20]
+///         (mtvec.MODE=3)
+void m_stats_nvi(void *s) {
+
+    register unsigned long *sf = (unsigned long *)s;
+    register unsigned long  cycle;
+
+    __csrr(cycle, CSR_MCYCLE);
+
+    if ( m_stats_on )
+        stats_add(&m_stats[STATS_EIID(sf[20])], cycle - sf[22]);
+}
+
+
+/// @name   s_stats_trap( *s )
+/// @brief  S-mode trap wrapper exit, trap id from scause (sf[18]), EIID of
+///         SEXT from topei (sf[20])
+void s_stats_trap(void *s) {
+
+    register unsigned long *sf = (unsigned long *)s;
+    register unsigned long  cycle;
+
+    __csrr(cycle, CSR_CYCLE);
+
+    if ( 0 == s_stats_on )
+        return;
+
+    cycle -= sf[22];
+
+    stats_add(&s_stats[STATS_CAUSE(sf[18])], cycle);
+
+    if ( (32 + TRAP_IID_SEXT) == STATS_CAUSE(sf[18]) )
+        stats_add(&s_stats[STATS_EIID(sf[20] >> 16)], cycle);
+}
+
+
+/// @name   stats_enable( level, on )
+/// @brief  start/stop counting of level (TMON_STATS_M/S), M-mode code
+int stats_enable(unsigned long level, int on) {
+
+    switch (level) {
+        case TMON_STATS_M:
+            m_stats_on = (on) ? 1 : 0;
+            return 0;
+        case TMON_STATS_S:
+            __csrs(CSR_MCOUNTEREN, 1);  // cycle for S-mode wrapper
+            s_stats_on = (on) ? 1 : 0;
+            return 0;
+    }
+
+    return -1;
+}
+
+
+/// @name   stats_read( level, first, num, *buf )
+/// @brief  copy num entries starting from trap id first
+/// @return number of copied entries, -1 - invalid level
+int stats_read(unsigned long level, unsigned long first, unsigned long num, tmon_stat_t *buf) {
+
+    register tmon_stat_t  *table;
+    register unsigned long i;
+
+    switch (level) {
+        case TMON_STATS_M:  table = m_stats;    break;
+        case TMON_STATS_S:  table = s_stats;    break;
+        default:
+            return -1;
+    }
+
+    for (i = 0; i < num && (first + i) < STATS_NUM; i++)
+        buf[i] = table[first + i];
+
+    return i;
+}
+
+
+/// @name   stats_reset( level )
+/// @brief  clear table of level
+int stats_reset(unsigned long level) {
+
+    register tmon_stat_t  *table;
+    register unsigned long i;
+
+    switch (level) {
+        case TMON_STATS_M:  table = m_stats;    break;
+        case TMON_STATS_S:  table = s_stats;    break;
+        default:
+            return -1;
+    }
+
+    for (i = 0; i < STATS_NUM; i++)
+        table[i] = (tmon_stat_t){};
+
+    return 0;
+}
+
+
+/// @name   stats_dump()
+/// @brief  print non-empty entries of both levels, cycles min/avg/max
+void stats_dump(void) {
+
+    static const char *level[2] = { "M", "S" };
+
+    register tmon_stat_t  *table;
+    register unsigned long i, l;
+
+    for (l = 0; l < 2; l++) {
+
+        table = (l) ? s_stats : m_stats;
+
+        for (i = 0; i < STATS_NUM; i++) {
+            if ( 0 == table[i].count )
+                continue;
+            printf("stats: %s #%ld count %lu, cycles %lu/%lu/%lu (min/avg/max)\n", level[l], i,
+                    table[i].count, table[i].min, (unsigned long)(table[i].sum / table[i].count), table[i].max);
+        }
+    }
+}
@@ -0,0 +1,51 @@
+/// @file       stats.h
+/// @brief      RISC-V Test Monitor - per-cause trap statistics, M-mode and
+///             S-mode code
+
+
+/*
+    Per-cause table of trap count and min/max/sum of handler cycles, one
+    table per level (m_stats, s_stats), indexed by trap id:
+
+    - 0..31 exceptions, 32..63 major interrupts, 64 + EIID external
+      interrupts, EIIDs >= STATS_EIID_NUM share the last entry
+    - trap wrappers (mtwr0.S, mtwr3.S, stwr0.S) store the entry cycle to
+      the trap stack frame sf[22] if the level is on and call
+      {m|s}_stats_trap() after the handler; level off costs 7 instructions
+      per trap (sf[22] clear, flag la/lw/beqz at entry, sf[22] lw/beqz
+      at exit)
+    - mtwr1.S, stwr1.S, stwr3.S are empty (no vectored mode wrappers) and
+      VS-mode wrappers (vtwr*.S) are not instrumented, so VS-mode traps
+      are not counted (no VS level table)
+    - external interrupt of mtvec/stvec.MODE=0 is counted twice, as major
+      interrupt (MEXT/SEXT) and as its EIID, nested (mtvec.MODE=3)
+      interrupts are counted by EIID only
+    - handler cycles are inclusive, preempting nested traps are counted in
+    - S-mode wrapper reads cycle, stats_enable() of S level sets
+      mcounteren.CY
+
+    Tables are read, reset and dumped with TMON_FID_STATS from any mode,
+    request and read buffer of lower privilege caller have to be in the
+    caller memory (tmon_caller_access()). Monitor exit request
+    (TMON_FID_EXIT) dumps enabled levels.
+*/
+
+#ifndef STATS_EIID_NUM
+#define STATS_EIID_NUM      64
+#endif
+
+#define STATS_NUM           (64 + STATS_EIID_NUM)
+
+extern unsigned long m_stats_on;
+extern unsigned long s_stats_on;
+extern tmon_stat_t   m_stats[STATS_NUM];
+extern tmon_stat_t   s_stats[STATS_NUM];
+
+extern void m_stats_trap( void *s );
+extern void m_stats_nvi ( void *s );
+extern void s_stats_trap( void *s );
+
+extern int  stats_enable( unsigned long level, int on );
+extern int  stats_read  ( unsigned long level, unsigned long first, unsigned long num, tmon_stat_t *buf );
+extern int  stats_reset ( unsigned long level );
+extern void stats_dump  ( void );
@@ -0,0 +1,125 @@
+/// @file       stmr.c
+/// @brief      RISC-V Test Monitor - S-mode timer driver (Sstc stimecmp),
+///             S-mode code
+
+#include "arch/arch.h"
+#include "tmon.h"
+#include "stvec.h"
+#include "stmr.h"
+#include "cntr.h"
+
+
+/* S-mode timer wheel */
+
+twheel_t s_twheel;
+
+
+/// @name   stmr_time()
+/// @brief  consistent 64-bit time CSR read on rv32
+u64_t stmr_time(void) {
+
+    return CNTR_READ64(CSR_TIMEH, CSR_TIME);
+}
+
+
+/// @name   stmr_compare( cmp )
+/// @brief  program stimecmp without spurious match, high part is parked
+///         at maximum while low part is written
+void stmr_compare(u64_t cmp) {
+
+    __csrw(CSR_STIMECMPH, ~0UL);
+    __csrw(CSR_STIMECMP,  (unsigned long)cmp);
+    __csrw(CSR_STIMECMPH, (unsigned long)(cmp >> 32));
+}
+
+
+/// @name   s_stmr_handler( *s )
+/// @brief  S-mode timer interrupt handler, expires timers and programs
+///         stimecmp for the nearest deadline (de-asserts STIP)
+static void s_stmr_handler(void *s) {
+
+    stmr_compare( twheel_run(&s_twheel, stmr_time(), s) );
+}
+
+
+/// @name   stmr_init()
+/// @brief  enable Sstc (menvcfgh.STCE) and time CSR access (mcounteren.TM)
+///         with monitor requests, empty timer wheel, install and enable
+///         STMR handler (needs stvec.MODE=0)
+int stmr_init(void) {
+
+    register unsigned long stvec;
+    tmon_csr_t req;
+
+    __csrr(stvec, CSR_STVEC);
+
+    if ( stvec & 0x03 ) {
+        WARNING("S-mode timer is not supported for stvec.MODE=%ld\n", stvec & 0x03);
+        return -1;
+    }
+
+    req = (tmon_csr_t){ CSR_MENVCFGH, 1UL << CSR_MENVCFGH_STCE_BIT };
+    tmon_call(TMON_FID_CSRS, &req);
+    req = (tmon_csr_t){ CSR_MCOUNTEREN, 1UL << CSR_XCOUNTEREN_TM_BIT };
+    tmon_call(TMON_FID_CSRS, &req);
+
+    stmr_compare(TWHEEL_NEVER);
+
+    twheel_init(&s_twheel, stmr_time());
+
+    s_maj_setvec(TRAP_IID_STMR, s_stmr_handler);
+    s_maj_enable(TRAP_IID_STMR, 1);
+
+    return 0;
+}
+
+
+/// @name   stmr_start( *t, delay, period, fn, *arg )
+/// @brief  start one-shot (period is 0) or periodic timer, delay and period
+///         are time ticks. Running timer is restarted
+int stmr_start(twheel_timer_t *t, u64_t delay, u64_t period, twheel_fn_t fn, void *arg) {
+
+    register unsigned long sie;
+
+    t->fn     = (fn) ? fn : (twheel_fn_t)s_trap_callback[32 + TRAP_IID_STMR];
+    t->arg    = arg;
+    t->period = period;
+
+    if ( 0 == t->fn ) {
+        ERROR("no callback assigned to S-mode timer\n");
+        return -1;
+    }
+
+    __csrr(sie, CSR_SIE);                       // wheel is updated by handler
+    __csrc(CSR_SIE, 1 << TRAP_IID_STMR);
+
+    t->expires = stmr_time() + delay;
+
+    twheel_add(&s_twheel, t);
+
+    if ( 0 == s_twheel.current )
+        stmr_compare( twheel_next(&s_twheel) ); // handler programs it otherwise
+
+    __csrs(CSR_SIE, sie & (1 << TRAP_IID_STMR));
+
+    return 0;
+}
+
+
+/// @name   stmr_stop( *t )
+/// @brief  stop pending timer, stimecmp is left as is (early interrupt
+///         reprograms it)
+int stmr_stop(twheel_timer_t *t) {
+
+    register unsigned long sie;
+    register int ret;
+
+    __csrr(sie, CSR_SIE);
+    __csrc(CSR_SIE, 1 << TRAP_IID_STMR);
+
+    ret = twheel_del(&s_twheel, t);
+
+    __csrs(CSR_SIE, sie & (1 << TRAP_IID_STMR));
+
+    return ret;
+}
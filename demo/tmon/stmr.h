@@ -0,0 +1,31 @@
+/// @file       stmr.h
+/// @brief      RISC-V Test Monitor - S-mode timer driver (Sstc stimecmp),
+///             S-mode code
+
+#pragma once
+
+
+/*
+    S-mode timers without M-mode trampolining (no set_timer request):
+
+    - stmr_time() reads consistent 64-bit time CSR on rv32 (CNTR_READ64)
+    - stimecmp is programmed directly by S-mode, STIP follows it
+      (menvcfgh.STCE, enabled with monitor request by stmr_init())
+    - timers are linked to S-mode timer wheel (twheel.c), stimecmp is
+      programmed for the nearest deadline only, same interface as mtmr.h
+    - timer without callback uses s_trap_callback[32 + TRAP_IID_STMR]
+    - STMR handler is installed to S-mode trap vector (stvec.MODE=0),
+      S-mode timer interrupt has to be delegated (m_maj_delegate())
+*/
+
+#include "twheel.h"
+
+extern twheel_t s_twheel;
+
+extern u64_t stmr_time   ( void );
+extern void  stmr_compare( u64_t cmp );
+extern int   stmr_init   ( void );
+extern int   stmr_start  ( twheel_timer_t *t, u64_t delay, u64_t period, twheel_fn_t fn, void *arg );
+extern int   stmr_stop   ( twheel_timer_t *t );
+
+#define stmr_current()  (s_twheel.current)
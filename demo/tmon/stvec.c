@@ -3,6 +3,7 @@
 
 #include "arch/arch.h"
 #include "tmon.h"
+#include "tpoint.h"
 
 /* S-mode trap wrappers */
 
@@ -21,8 +22,10 @@ static void s_exc_cross_fault (void *s);
 static void s_exc_store_fault (void *s);    
 
 static void s_exc_default(void *s);
-static void s_maj_default(void);
-static void s_ext_default(void);
+static void s_maj_default(void *s);
+static void s_ext_default(void *s);
+
+static void s_maj_ext_wrapper(void *s);
 
 /* S-mode Software Trap Vector Table */
 
@@ -61,25 +64,26 @@ void *s_trap_vector[96] = {
     (void*) s_exc_default,          // 27
     (void*) s_exc_default,          // 28
     (void*) s_exc_default,          // 29
-    (void*) s_exc_default,          // 30s    (void*) m_exc_default,          // 31   --
+    (void*) s_exc_default,          // 30
+    (void*) s_exc_default,          // 31   --
 
     /* 32..63 - major interrupts */
     
-    (void*) s_maj_default,          // 32
-    (void*) s_maj_default,          // 33
-    (void*) s_maj_default,          // 34
-    (void*) s_maj_default,          // 35
-    (void*) s_maj_default,          // 36
-    (void*) s_maj_default,          // 37
-    (void*) s_maj_default,          // 38
-    (void*) s_maj_default,          // 39
-
-    (void*) s_maj_default,          // 40
-    (void*) s_maj_default,          // 41
-    (void*) s_maj_default,          // 42
-    (void*) s_maj_default,          // 43
-    (void*) s_maj_default,          // 44
-    (void*) s_maj_default,          // 45
+    (void*) s_maj_default,          // 32 maj0  unused
+    (void*) s_maj_default,          // 33 maj1  S-mode software interrupt
+    (void*) s_maj_default,          // 34 maj2  VS-mode software interrupt
+    (void*) s_maj_default,          // 35 maj3  -
+    (void*) s_maj_default,          // 36 maj4  unused
+    (void*) s_maj_default,          // 37 maj5  S-mode timer interrupt
+    (void*) s_maj_default,          // 38 maj6  VS-mode timer interrupt
+    (void*) s_maj_default,          // 39 maj7  -
+
+    (void*) s_maj_default,          // 40 maj8  unused
+    (void*) s_maj_ext_wrapper,      // 41 maj9  S-mode external interrupt
+    (void*) s_maj_default,          // 42 maj10 VS-mode external interrupt
+    (void*) s_maj_default,          // 43 maj11 -
+    (void*) s_maj_default,          // 44 maj12 Guest external interrupt
+    (void*) s_maj_default,          // 45 maj13 Counter overflow interrupt
     (void*) s_maj_default,          // 46
     (void*) s_maj_default,          // 47
 
@@ -140,6 +144,15 @@ void *s_trap_vector[96] = {
     (void*) s_ext_default,          // 95
 };
 
+/* S-mode Trap User Callback Vector */
+
+void *s_trap_callback[96] = {};
+
+/* HS-mode Trap Delegation State (copy of hedeleg/hideleg for VS-mode monitor) */
+
+volatile unsigned long s_exc_deleg = 0;
+volatile unsigned long s_int_deleg = 0;
+
 
 /******************************************************************************
 ** S-mode default trap handlers 
@@ -150,32 +163,93 @@ void *s_trap_vector[96] = {
 /// @brief  default S-mode exception trap handler
 static void s_exc_default(void *s) {
 
-    register unsigned long *sf = (unsigned long *)s;
+    register unsigned long *sf      = (unsigned long *)s;
+    register unsigned long scause   = sf[18];
+
+    if ( scause == s_queue_pop() ) {
+        TRACE("expected S-mode exception trap #0x%lx\n", scause);
+        if ( 0 != s_trap_callback[scause] ) {
+            ((void (*)(void*))(s_trap_callback[scause]))(s);   
+        }
+        else {
+            WARNING("no user callback assigned to trap #%ld\n", scause);
+        }
+    }
+    else {
+        ERROR("unexpected S-mode exception trap #%ld @PC=%lu\n", scause, sf[17]);
+        TRACE("scause: 0x%lx; sstatus: 0x%lx\n", sf[18], sf[16] );
+        exit(-1);
+    }
+}
+
 
-    ERROR("unexpected S-mode exception trap @PC=%lu\n", sf[17]);
-    TRACE("scause: 0x%lx; sstatus: 0x%lx\n", sf[18], sf[16] );
+/// @name   s_maj_default( *s )
+/// @brief  default S-mode major interrupt trap handler
+static void s_maj_default(void *s) {
 
-    exit(-1);
+    register unsigned long *sf      = (unsigned long *)s;
+    register unsigned long iid      = sf[18] & ~CSR_xCAUSE_INT_MASK;
+    register unsigned long expect   = s_queue_pop();
+
+    if ( (32 + iid) == expect ) {
+        TRACE("expected S-mode major interrupt trap iid=%ld\n", iid);
+        if ( 0 != s_trap_callback[expect] ) {
+            ((void (*)(void*))(s_trap_callback[expect]))(s);   
+        }
+        else {
+            WARNING("no user callback assigned to trap #%ld\n", expect);
+        }
+    }
+    else {
+        ERROR("unexpected S-mode major interrupt trap #%ld, expected #%ld\n", iid, expect - 32);
+        TRACE("scause: 0x%lx; sstatus: 0x%lx\n", sf[18], sf[16] );
+        exit(-1);
+    }
 }
 
 
-/// @name   s_maj_default()
-/// @brief  default S0mode major interrupt trap
-static void s_maj_default(void) {
+/// @name   s_ext_default( *s )
+/// @brief  default S-mode external interrupt trap handler
+static void s_ext_default(void *s) {
 
-    ERROR("unexpected S-mode major interrupt trap\n");
+    register unsigned long *sf      = (unsigned long *)s;
+    register unsigned long eiid     = sf[20] >> 16;
+    register unsigned long expect   = s_queue_pop();
 
-    exit(-1);
+    if ( (64 + eiid) == expect && expect < 96 ) {
+        TRACE("expected S-mode external interrupt trap eiid=%ld\n", eiid);
+        if ( 0 != s_trap_callback[expect] ) {
+            ((void (*)(void*))(s_trap_callback[expect]))(s);   
+        }
+        else {
+            WARNING("default external interrupt handler with no user callback assigned to #%ld\n", expect);
+        }
+    }
+    else {
+        ERROR("unexpected S-mode external interrupt trap #%ld, expect %ld\n", eiid, expect - 64);
+        TRACE("scause: 0x%lx; epc: 0x%lx\n", sf[18], sf[17] );
+        exit(-1);
+    }
 }
 
 
-/// @name   s_ext_default( )
-/// @brief  default S-mode external interrupt trap
-static void s_ext_default(void) {
+/// @name   s_maj_ext_wrapper( *s )
+/// @brief  default S-mode major external interrupt handler, stvec.MODE=0 
+static void s_maj_ext_wrapper(void *s) {
+
+    register unsigned long *sf      = (unsigned long *)s;
+    register unsigned long topei;
 
-    ERROR("unexpected S-mode external interrupt trap\n");
+    // read top eiid and claim it
+    __csrrw(topei, CSR_STOPEI, 0);
 
-    exit(-1);
+    sf[20] = topei;     // store topei to the trap stack frame, 
+                        // so it is visible at the next level 
+ 
+    if ( (topei >> 16) < 32 )
+        return ((void (*)(void*))(s_trap_vector[64 + (topei >> 16)]))(s);
+
+    return s_ext_default(s);            // no vector beyond EIID 31
 }
 
 /******************************************************************************
@@ -192,7 +266,7 @@ void s_exc_illegal_inst(void *s ) {
 
     __csrr(tval, CSR_STVAL);
 
-    if ( 2 == queue_pop() ) {
+    if ( 2 == s_queue_pop() ) {
 
         TRACE("expected illegal instruction trap @0x%lx\n", tval);
         sf[17] += 4;                        // shift epc, skip faulty instruction
@@ -216,7 +290,9 @@ static void s_exc_fetch_fault(void *s ) {
 
     __csrr(tval, CSR_STVAL);
 
-    if ( 12 == queue_pop() ) {
+    TPOINT(TP_S_FAULT, sf[18], tval);
+
+    if ( 12 == s_queue_pop() ) {
 
         TRACE("expected instruction fetch fault @0x%lx\n", tval);
         sf[17] = sf[0];                     // load ra to epc, skip faulty instruction
@@ -239,7 +315,9 @@ static void s_exc_load_fault (void *s ) {
 
     __csrr(tval, CSR_STVAL);
 
-    if ( 13 == queue_pop() ) {
+    TPOINT(TP_S_FAULT, sf[18], tval);
+
+    if ( 13 == s_queue_pop() ) {
 
         TRACE("expected data load fault @0x%lx\n", tval);
         sf[17] += 4;                        // shift epc, skip faulty instruction
@@ -262,7 +340,9 @@ static void s_exc_cross_fault(void *s ) {
 
     __csrr(tval, CSR_STVAL);
 
-    if ( 14 == queue_pop() ) {
+    TPOINT(TP_S_FAULT, sf[18], tval);
+
+    if ( 14 == s_queue_pop() ) {
 
         TRACE("expected SMPU region crossing fault @0x%lx\n", tval);
         sf[17] += 4;                        // shift epc, skip faulty instruction
@@ -286,7 +366,9 @@ static void s_exc_store_fault(void *s ) {
 
     __csrr(tval, CSR_STVAL);
 
-    if ( 15 == queue_pop() ) {
+    TPOINT(TP_S_FAULT, sf[18], tval);
+
+    if ( 15 == s_queue_pop() ) {
 
         TRACE("expected data store fault @0x%lx\n", tval);
         sf[17] += 4;                        // shift epc, skip faulty instruction
@@ -334,6 +416,201 @@ int s_trap_mode(int mode) {
 }
 
 
+/// @name   s_exc_setvec(eid, *handler)
+/// @brief  add exception trap handler entry to vector table 
+///         (depends on configured trap handling mode)
+int s_exc_setvec(int eid, void *handler) {
+
+    register unsigned long stvec;
+
+    __csrr(stvec, CSR_STVEC);
+
+    switch (stvec & 0x03) {
+        case 0:
+        case 3:
+            s_trap_vector[eid] = handler;
+            break;
+        case 1:
+        // not supported yet
+        default:
+            ERROR("setting trap vector for stvec.MODE=%ld is not implemented\n", stvec & 0x03);
+            exit(-1);
+    }
+
+    return 0;
+}
+
+
+/// @name   s_maj_setvec(iid, *handler)
+/// @brief  add major interrupt trap handler entry to vector table
+///         (depends on configured trap handling mode)
+int s_maj_setvec(int iid, void *handler) {
+
+    register unsigned long stvec;
+
+    __csrr(stvec, CSR_STVEC);
+
+    switch (stvec & 0x03) {
+        case 0:
+            s_trap_vector[32 + iid] = handler;
+            break;
+        case 3:
+            ERROR("S-mode nested vectored mode is not supported, no stwr3 trap wrapper\n");
+            return -1;
+        case 1:
+        // not supported yet
+        default:
+            ERROR("not yet implemented\n");
+            exit(-1);
+    }
+
+    return 0;
+}
+
+
+/// @name   s_ext_setvec(eiid, *handler)
+/// @brief  add external interrupt trap handler entry to vector table
+///         (depends on configured trap handling mode), EIID 0..31, 
+///         stvec.MODE=0 only
+int s_ext_setvec(int eiid, void *handler) {
+
+    register unsigned long stvec;
+
+    if ( eiid < 0 || eiid >= 32 ) {
+        ERROR("S-mode external interrupt #%d has no trap vector entry\n", eiid);
+        return -1;
+    }
+
+    __csrr(stvec, CSR_STVEC);
+
+    switch (stvec & 0x03) {
+        case 0:
+            s_trap_vector[32 + 32 + eiid] = handler;
+            break;
+        case 3:
+            // no S-mode nested vectored trap wrapper (stwr3.S)
+        case 1:
+        // not yet supported
+        default:
+            WARNING("not yet implemented for stvec.MODE=%ld\n", stvec & 0x03);
+            return -1;
+    }
+
+    return 0;
+}
+
+
+/// @name   s_exc_delegate(eid, delegate)
+/// @brief  enable/disable HS-mode exception trap delegation to VS-mode
+int s_exc_delegate(int eid, int delegate) {
+
+    if (delegate)
+        __csrs(CSR_HEDELEG, (1 << eid));
+    else
+        __csrc(CSR_HEDELEG, (1 << eid));
+
+    __csrr(s_exc_deleg, CSR_HEDELEG);
+
+    return 0;
+}
+
+
+/// @name   s_maj_delegate(iid, delegate)
+/// @brief  enable/disable HS-mode major interrupt delegation to VS-mode
+///         (VSSI, VSTI, VSEI)
+int s_maj_delegate(int iid, int delegate) {
+
+    if (delegate)
+        __csrs(CSR_HIDELEG, (1 << iid));
+    else
+        __csrc(CSR_HIDELEG, (1 << iid));
+
+    __csrr(s_int_deleg, CSR_HIDELEG);
+
+    return 0;
+}
+
+
+/// @name   s_maj_priority(iid, priority)
+/// @brief  Set S-level major interrupt priority (siprio registers)
+int s_maj_priority(int iid, int priority) {
+
+    register unsigned long ireg = IMSIC_IPRIO_REG(iid);
+    register unsigned long ival;
+
+    __csrw(CSR_SISELECT, ireg);
+    __csrr(ival, CSR_SIREG);
+
+    ival &= ~(0xff << ((iid % 4) * 8));
+    ival |= (priority << ((iid % 4) * 8));
+
+    __csrw(CSR_SIREG, ival);
+
+    return 0;
+}
+
+
+/// @name   s_maj_enable(iid, enable)
+/// @brief  Enable/disable S-mode major interrupt (sie/sieh)
+int s_maj_enable(int iid, int enable) {
+
+    if (enable)
+        if (iid < 32)
+            __csrs(CSR_SIE, 1 << iid);
+        else    
+            __csrs(CSR_SIEH, 1 << (iid - 32));
+    else
+        if (iid < 32)
+            __csrc(CSR_SIE, 1 << iid);
+        else    
+            __csrc(CSR_SIEH, 1 << (iid - 32));
+
+    return 0;
+}
+
+
+/// @name   s_ext_enable(eiid, enable)
+/// @brief  Enable/disable S-level IMSIC interrupt by EIID
+int s_ext_enable(int eiid, int enable) {
+
+    register unsigned long ireg = S_EI_ENABLE_REG(eiid >> 5);
+    register unsigned long ival = 1 << (eiid % 32);
+
+    __csrw(CSR_SISELECT, ireg);
+
+    if (enable)
+        __csrs(CSR_SIREG, ival);
+    else    
+        __csrc(CSR_SIREG, ival);
+
+    return 0;
+}
+
+
+/// @name   s_ext_delivery(enable)
+/// @brief  Enable/disable S-level IMSIC MSI delivery
+int s_ext_delivery(int enable) {
+
+    __csrw(CSR_SISELECT, S_EI_DELIVERY_REG);
+
+    if (enable)
+        __csrw(CSR_SIREG, 1);
+    else    
+        __csrw(CSR_SIREG, 0);
+
+    return 0;
+}
+
+
+/// @name   s_ext_threshold(threshold)
+/// @brief  Set S-level IMSIC priority threshold level
+int s_ext_threshold(int threshold) {
+
+    __csrw(CSR_SISELECT, S_EI_THRESHOLD_REG);
+    __csrw(CSR_SIREG, (unsigned long)threshold);
+
+    return 0;    
+}
 
 
 /// @name   s_all_enable( enable )
@@ -1,6 +1,7 @@
 /// @file   tmon.c
 /// @brief  RISC-V Virtual Platform - Test Monitor 
 
+#include "arch/arch.h"
 #include "tmon.h"
 
 /* Test Monitor Event Queue */
@@ -14,6 +15,36 @@ static tmon_queue_t q = {
     .size = 128,
 };
 
+/* Test Monitor S-mode Event Queue (delegated traps) */
+
+static unsigned long s_buff[128];
+
+static tmon_queue_t s_q = {
+    .head = s_buff,
+    .tail = s_buff,
+    .buff = s_buff,
+    .size = 128,
+};
+
+/* Test Monitor VS-mode Event Queue (traps delegated to VS-mode) */
+
+static unsigned long v_buff[128];
+
+static tmon_queue_t v_q = {
+    .head = v_buff,
+    .tail = v_buff,
+    .buff = v_buff,
+    .size = 128,
+};
+
+
+/* Test Monitor Request Ring, shared with S/U-mode */
+
+tmon_ring_t tmon_ring __attribute__((aligned(32))) = {
+    .head = 0,
+    .tail = 0,
+};
+
 
 /* Test Monitor Privilege Modes */
 
@@ -31,14 +62,14 @@ const char *priv_s[8] = {
 
 /* Test Monitor event queue API */
 
-/// @name 
-/// @brief
-void queue_append(unsigned long e ) {
+/// @name   tmon_queue_append( *pq, e )
+/// @brief  append event to the queue
+static void tmon_queue_append(tmon_queue_t *pq, unsigned long e ) {
 
-    *(q.tail++) = e;
-    q.tail = (q.tail < (q.buff + q.size)) ? q.tail : q.buff;
+    *(pq->tail++) = e;
+    pq->tail = (pq->tail < (pq->buff + pq->size)) ? pq->tail : pq->buff;
 
-    if (q.tail == q.head) {
+    if (pq->tail == pq->head) {
         ERROR("queue is full\n");
         exit(-1);
     }  
@@ -46,20 +77,207 @@ void queue_append(unsigned long e ) {
 }
 
 
-/// @name 
-/// @brief
-unsigned long queue_pop(void ) {
+/// @name   tmon_queue_pop( *pq )
+/// @brief  pop event from the queue, 0 if queue is empty
+static unsigned long tmon_queue_pop(tmon_queue_t *pq ) {
 
-    register unsigned long head = (q.head == q.tail) ? 0 : *(q.head++);
-    q.head = (q.head < (q.buff + q.size)) ? q.head : q.buff;
+    register unsigned long head = (pq->head == pq->tail) ? 0 : *(pq->head++);
+    pq->head = (pq->head < (pq->buff + pq->size)) ? pq->head : pq->buff;
 
     return head;
 }
 
+
+/// @name   tmon_queue_is_empty( *pq )
+/// @brief  number of events in the queue
+static unsigned long tmon_queue_is_empty(tmon_queue_t *pq ) {
+
+    return ((pq->head - pq->tail) < 0 ) ? pq->tail - pq->head : pq->head - pq->tail;
+
+}
+
+
 /// @name 
-/// @brief
+/// @brief  M-mode event queue
+void queue_append(unsigned long e ) {
+
+    tmon_queue_append(&q, e);
+}
+
+unsigned long queue_pop(void ) {
+
+    return tmon_queue_pop(&q);
+}
+
 unsigned long queue_is_empty(void ) {
 
-    return ((q.head - q.tail) < 0 ) ? q.tail - q.head : q.head - q.tail;
+    return tmon_queue_is_empty(&q);
+}
+
+
+/// @name 
+/// @brief  S-mode event queue
+void s_queue_append(unsigned long e ) {
+
+    tmon_queue_append(&s_q, e);
+}
+
+unsigned long s_queue_pop(void ) {
+
+    return tmon_queue_pop(&s_q);
+}
+
+unsigned long s_queue_is_empty(void ) {
+
+    return tmon_queue_is_empty(&s_q);
+}
+
+
+/// @name 
+/// @brief  VS-mode event queue
+void v_queue_append(unsigned long e ) {
+
+    tmon_queue_append(&v_q, e);
+}
+
+unsigned long v_queue_pop(void ) {
+
+    return tmon_queue_pop(&v_q);
+}
+
+unsigned long v_queue_is_empty(void ) {
+
+    return tmon_queue_is_empty(&v_q);
+}
+
+
+/* Test Monitor request ring API */
+
+/// @name   tmon_post(fid, arg)
+/// @brief  post asynchronous request to M-mode monitor, no ecall required.
+///         Request is served on the next M-mode trap (see m_ring_drain()).
+/// @note   single producer, rv32i - no atomics: head is written by 
+///         producer only, tail is written by M-mode monitor only. 
+int tmon_post(unsigned long fid, unsigned long arg) {
+
+    register unsigned long head = tmon_ring.head;
+
+    if ((head - tmon_ring.tail) >= TMON_RING_SIZE) {
+        return -1;                                  // ring is full
+    }
+
+    tmon_ring.req[head & (TMON_RING_SIZE - 1)][0] = fid;
+    tmon_ring.req[head & (TMON_RING_SIZE - 1)][1] = arg;
+
+    asm volatile ("fence w, w" ::: "memory");       // publish request before head
+
+    tmon_ring.head = head + 1;
+
+    return 0;
+}
+
+
+/* Guest interrupt files (GEILEN), probed once */
+
+static unsigned long tmon_gfiles = ~0UL;       // ~0 - not probed, hgeie bit 0 is read-only 0
+
+
+/// @name   tmon_gfile_mask()
+/// @brief  mask of implemented guest interrupt files (writable hgeie bits),
+///         hgeie is probed on the first call only, with S-level interrupts 
+///         masked (no SGEI while all bits are set). M/HS-mode code
+unsigned long tmon_gfile_mask(void) {
+
+    unsigned long sstatus, hgeie;
+
+    if ( ~0UL == tmon_gfiles ) {
+
+        __csrr( sstatus, CSR_SSTATUS );
+        __csrc( CSR_SSTATUS, 1 << CSR_xSTATUS_SIE_BIT );
+
+        __csrr( hgeie, CSR_HGEIE );
+        __csrw( CSR_HGEIE, ~0UL );
+        __csrr( tmon_gfiles, CSR_HGEIE );
+        __csrw( CSR_HGEIE, hgeie );
+
+        __csrs( CSR_SSTATUS, sstatus & (1 << CSR_xSTATUS_SIE_BIT) );
+    }
+
+    return tmon_gfiles;
+}
+
+
+/// @name   tmon_gmsi( a1 )
+/// @brief  send MSI to IMSIC guest interrupt file a1[31:16] with EIID a1[15:0],
+///         or assert/de-assert VS external interrupt with hvip.VSEIP (guest 
+///         file 0, software injection). TMON_FID_GMSI of M- and HS-mode monitors
+/// @return 0 - OK, -1 - guest interrupt file is not implemented
+int tmon_gmsi(unsigned long a1) {
+
+    register unsigned long eiid   = a1 & 0xFFFF;
+    register unsigned long gfile  = a1 >> 16;
+
+    if ( 0 != gfile ) {
+        if ( !tmon_gfile_valid(gfile) ) {
+            ERROR("guest interrupt file #%ld is not implemented\n", gfile);
+            return -1;
+        }
+        __smsi_base[gfile * (IMSIC_GUEST_IFILE_STRIDE / sizeof(long))] = eiid;
+    }
+    else if ( 0 != eiid )
+        __csrs(CSR_HVIP, HIP_VSEIP);
+    else
+        __csrc(CSR_HVIP, HIP_VSEIP);
+
+    return 0;
+}
+
+
+/* Memory of lower privilege callers, shared regions of SMPU/SPMP memory
+   maps (linker.ld): .rodata up to stack top readable, .data up to stack
+   top writable */
+
+extern long __rodata_base[], __data_base[], __data_top[];
+
+
+/// @name   tmon_caller_range( addr, size, write )
+/// @brief  [addr, addr + size) is in memory of lower privilege callers
+static int tmon_caller_range(unsigned long addr, unsigned long size, int write) {
+
+    register unsigned long  base = (write) ? (unsigned long)__data_base : (unsigned long)__rodata_base;
+    register unsigned long  top  = (unsigned long)__data_top;
+
+    return (addr >= base) && (addr <= top) && (size <= top - addr);
+}
+
+
+/// @name   tmon_caller_access( *s, addr, size, write )
+/// @brief  check that [addr, addr + size) is accessible by the caller of
+///         M-mode request (mstatus.MPP of trap stack frame s) before it is
+///         accessed with M-mode privilege. M-mode caller may pass any
+///         address, finer caller memory maps are not consulted
+/// @return 1 - accessible, 0 - not accessible
+int tmon_caller_access(void *s, unsigned long addr, unsigned long size, int write) {
+
+    register unsigned long *sf   = (unsigned long *)s;
+
+    if ( CSR_MSTATUS_MPP_MASK == (sf[16] & CSR_MSTATUS_MPP_MASK) )
+        return 1;
+
+    return tmon_caller_range(addr, size, write);
+}
+
+
+/// @name   tmon_s_caller_access( *s, addr, size, write )
+/// @brief  S-mode monitor version of tmon_caller_access(), S-mode caller
+///         (sstatus.SPP of trap stack frame s) may pass any address
+/// @return 1 - accessible, 0 - not accessible
+int tmon_s_caller_access(void *s, unsigned long addr, unsigned long size, int write) {
+
+    register unsigned long *sf   = (unsigned long *)s;
+
+    if ( sf[16] & (1UL << CSR_xSTATUS_SPP_BIT) )
+        return 1;
 
+    return tmon_caller_range(addr, size, write);
 }
@@ -22,6 +22,16 @@ typedef struct tmon_queue_s {
     unsigned long  size;
 } tmon_queue_t;
 
+/* Test Monitor Request Ring */
+
+#define TMON_RING_SIZE      32      // number of ring entries, must be power of 2
+
+typedef struct tmon_ring_s {
+    volatile unsigned long head;                    // next free entry, written by producer only
+    volatile unsigned long tail;                    // next pending entry, written by M-mode only
+    volatile unsigned long req[TMON_RING_SIZE][2];  // { fid, arg } request pairs
+} tmon_ring_t;
+
 /* Test Monitor data types */
 
 typedef signed long long    s64_t;
@@ -66,6 +76,7 @@ enum trap_eid_e {
     TRAP_EID_LOAD_FAULT    = 13,
     TRAP_EID_CROSS_FAULT   = 14,
     TRAP_EID_STORE_FAULT   = 15,
+    TRAP_EID_VIRTUAL_INST  = 22,
 };
 
 enum trap_iid_e {
@@ -97,6 +108,9 @@ extern const char *priv_s[8];
 #define VS_MODE      ((void*)(5))
 #define VM_MODE      ((void*)(7))
 
+#define TMON_PRIV_RESUME    0x10    // target mode flag of trap wrapper exit (stwr0.S, vtwr0.S),
+                                    // resume at the left trap's sepc/vsepc
+
 /* Test monitor environment function calls  */
 
 typedef enum fid_e {
@@ -118,18 +132,53 @@ typedef enum fid_e {
     TMON_FID_MMSI   = 15,       // send M-mode MSI (external) interrupt
     TMON_FID_SMSI   = 16,       // send S-mode MSI (external) interrupt
     TMON_FID_CB     = 17,       // link user callback to the specified trap handler
+    TMON_FID_QPRIV  = 18,       // privilege switch without trace (upward transitions)
+    TMON_FID_GMSI   = 19,       // send guest MSI (IMSIC guest file) or inject VS external interrupt
+    TMON_FID_APLIC  = 20,       // APLIC source/target configuration, wired source and genmsi injection
+    TMON_FID_BMSI   = 21,       // send burst of M/S-mode MSIs (EIID list or range)
+    TMON_FID_STATS  = 22,       // per-cause trap statistics (enable, read, reset, dump)
+    TMON_FID_TPOINT = 23,       // enable/disable dynamic tracepoints by id or name, dump
 } fid_t;
 
+/* Guest MSI request (TMON_FID_GMSI argument), gfile 1..GEILEN - IMSIC guest 
+   interrupt file, gfile 0 - VS external interrupt injected by hypervisor 
+   with hvip.VSEIP (eiid != 0 asserts, eiid == 0 de-asserts) */
+
+#define TMON_GMSI(__gfile__, __eiid__)  ((((unsigned long)(__gfile__)) << 16) | (__eiid__))
+
 
 /* Test monitor exception/interrupt vectors */
 
 extern void* m_trap_vector[];
 extern void* s_trap_vector[];
+extern void* v_trap_vector[];
 
 /* User trap-call-back vectors */
 
 extern void* m_trap_callback[];
 extern void* s_trap_callback[];
+extern void* v_trap_callback[];
+
+/* M-mode sparse external interrupt table (mtvec.c), EIIDs beyond m_trap_vector[] */
+
+#ifndef M_EXT_EIID_NUM
+#define M_EXT_EIID_NUM      2048    // IMSIC interrupt identities
+#endif
+#ifndef M_EXT_BLOCK_NUM
+#define M_EXT_BLOCK_NUM     8       // blocks of 32 EIIDs with registered handlers/callbacks
+#endif
+
+extern int m_ext_link(unsigned long eiid, int callback, void *ptr);
+
+/* M-mode trap delegation state (medeleg, mideleg copy), readable by S-mode monitor */
+
+extern volatile unsigned long m_exc_deleg;
+extern volatile unsigned long m_int_deleg;
+
+/* HS-mode trap delegation state (hedeleg, hideleg copy), readable by VS-mode monitor */
+
+extern volatile unsigned long s_exc_deleg;
+extern volatile unsigned long s_int_deleg;
 
 /*
     Vector Table:
@@ -162,6 +211,94 @@ typedef struct {
 } ret_t;
 
 
+/* CSR/iCSR access request (TMON_FID_CSRx, TMON_FID_ICSRx argument) */
+
+typedef struct tmon_csr_s {
+    unsigned long   csr;        // CSR address or M-level iCSR index (miselect)
+    unsigned long   val;        // data to write/set/clear, or read back data
+} tmon_csr_t;
+
+#define TMON_CSR_ARRAY      0x80000000      // array form: { TMON_CSR_ARRAY | num, &tmon_csr_t[num] }
+#define TMON_CSR_ARRAY_MAX  64              // max number of requests in array form
+
+
+/* APLIC request (TMON_FID_APLIC argument), see aplic.c */
+
+enum tmon_aplic_op_e {
+    TMON_APLIC_INIT     = 0,    // MSI delivery mode, IMSIC addresses
+    TMON_APLIC_SOURCE   = 1,    // sourcecfg[src] = arg (source mode), enable source
+    TMON_APLIC_TARGET   = 2,    // target[src] = arg (EIID)
+    TMON_APLIC_SETIP    = 3,    // set pending arg sources starting from src (burst)
+    TMON_APLIC_GENMSI   = 4,    // genmsi, src is EIID
+};
+
+typedef struct tmon_aplic_s {
+    unsigned long   op;         // TMON_APLIC_xxx
+    unsigned long   domain;     // APLIC_M_DOMAIN, APLIC_S_DOMAIN
+    unsigned long   src;        // source number 1..1023 (EIID for genmsi)
+    unsigned long   arg;        // source mode, target EIID or number of sources
+} tmon_aplic_t;
+
+
+/* Burst MSI request (TMON_FID_BMSI argument) */
+
+#define TMON_BMSI_M     0       // M-level IMSIC file (__mmsi_base)
+#define TMON_BMSI_S     1       // S-level IMSIC file (__smsi_base)
+#define TMON_BMSI_MAX   2047    // max MSIs per burst (EIIDs 1..2047)
+
+typedef struct tmon_bmsi_s {
+    unsigned long        level;     // TMON_BMSI_M, TMON_BMSI_S
+    unsigned long        num;       // number of MSIs
+    unsigned long        first;     // first EIID of range (list is 0)
+    const unsigned long *list;      // EIID list (caller memory), 0 - range first..first+num-1
+} tmon_bmsi_t;
+
+
+/* Trap statistics request (TMON_FID_STATS argument), see stats.c. Table index
+   is trap id: 0..31 exceptions, 32..63 major interrupts, 64 + EIID external
+   interrupts (EIIDs beyond the table share the last entry) */
+
+enum {
+    TMON_STATS_ENABLE   = 0,    // start (num != 0) or stop (num == 0) counting
+    TMON_STATS_READ     = 1,    // copy num entries starting from first to buf
+    TMON_STATS_RESET    = 2,    // clear table
+    TMON_STATS_DUMP     = 3,    // print non-empty entries
+};
+
+#define TMON_STATS_M    0       // M-mode trap wrappers
+#define TMON_STATS_S    1       // S-mode trap wrapper
+
+typedef struct tmon_stat_s {
+    unsigned long   count;      // traps
+    unsigned long   min;        // handler cycles
+    unsigned long   max;
+    u64_t           sum;
+} tmon_stat_t;
+
+typedef struct tmon_stats_s {
+    unsigned long   op;         // TMON_STATS_xxx
+    unsigned long   level;      // TMON_STATS_M, TMON_STATS_S
+    unsigned long   first;      // first trap id (READ)
+    unsigned long   num;        // number of entries (READ), on/off (ENABLE)
+    tmon_stat_t    *buf;        // destination (READ)
+} tmon_stats_t;
+
+
+/* Tracepoint request (TMON_FID_TPOINT argument), see tpoint.c */
+
+enum {
+    TMON_TPOINT_ENABLE  = 0,    // patch sites with branch to record path
+    TMON_TPOINT_DISABLE = 1,    // patch sites with nop
+    TMON_TPOINT_DUMP    = 2,    // print hit counters and record ring
+};
+
+typedef struct tmon_tpoint_s {
+    unsigned long   op;         // TMON_TPOINT_xxx
+    unsigned long   id;         // tracepoint id (TP_xxx), used if name is 0
+    const char     *name;       // tracepoint name
+} tmon_tpoint_t;
+
+
 /* printf.c */
 extern int32_t  printf(const char* fmt, ...);
 extern int32_t  puts(const char* str);
@@ -171,6 +308,26 @@ extern void queue_append(unsigned long e);
 extern unsigned long queue_pop(void);
 extern unsigned long queue_is_empty(void );
 
+extern void s_queue_append(unsigned long e);
+extern unsigned long s_queue_pop(void);
+extern unsigned long s_queue_is_empty(void );
+
+extern void v_queue_append(unsigned long e);
+extern unsigned long v_queue_pop(void);
+extern unsigned long v_queue_is_empty(void );
+
+extern tmon_ring_t tmon_ring;
+extern int  tmon_post(unsigned long fid, unsigned long arg);
+
+extern unsigned long tmon_gfile_mask(void);
+extern int  tmon_gmsi(unsigned long a1);
+extern int  tmon_caller_access(void *s, unsigned long addr, unsigned long size, int write);
+extern int  tmon_s_caller_access(void *s, unsigned long addr, unsigned long size, int write);
+
+#define tmon_gfile_valid(__gfile__)     (((__gfile__) > 0) && ((__gfile__) < 32) && ((tmon_gfile_mask() >> (__gfile__)) & 1))
+
+/* mmon.c */
+extern void m_ring_drain(void);
 
 
 /* tmon.c */
@@ -183,6 +340,10 @@ extern unsigned long queue_is_empty(void );
     asm volatile ( "ecall \n" : "+r"(a0), "+r"(a1) : : "memory" );      \
 }
 
+/* upward privilege switch, downward switches are done with m_priv_drop()/s_priv_drop() */
+
+#define tmon_priv_raise(__mode__)   tmon_call(TMON_FID_QPRIV, __mode__)
+
 
 /* helper macros */
 
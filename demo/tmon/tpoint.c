@@ -0,0 +1,114 @@
+/// @file       tpoint.c
+/// @brief      RISC-V Test Monitor - jump-label style dynamic tracepoints,
+///             M-mode (patching) and any mode (sites) code
+
+#include "arch/arch.h"
+#include "tmon.h"
+#include "tpoint.h"
+
+
+/* site table (linker.ld) */
+
+extern const tpoint_site_t __tpoint_start[], __tpoint_end[];
+
+/* tracepoint names */
+
+#define TPOINT_NAME(__id__, __name__)   __name__,
+
+static const char *tpoint_name[TP_NUM] = { TPOINT_LIST(TPOINT_NAME) };
+
+/* record ring, shared by M-mode and S-mode sites */
+
+tpoint_ring_t tpoint_ring;
+
+
+/// @name   tpoint_jal( site, target )
+/// @brief  "jal zero, target - site" encoding (J-type, +/-1MiB)
+static unsigned long tpoint_jal(unsigned long site, unsigned long target) {
+
+    register unsigned long off = target - site;
+
+    return ((off & 0x100000) << 11) |       // imm[20]    -> [31]
+           ((off & 0x0007FE) << 20) |       // imm[10:1]  -> [30:21]
+           ((off & 0x000800) <<  9) |       // imm[11]    -> [20]
+           ( off & 0x0FF000)        |       // imm[19:12] -> [19:12]
+           0x6F;                            // jal, rd = zero
+}
+
+
+/// @name   tpoint_hit( id, a, b )
+/// @brief  record path of enabled site, any mode
+void tpoint_hit(unsigned long id, unsigned long a, unsigned long b) {
+
+    register tpoint_rec_t *r = &tpoint_ring.rec[tpoint_ring.num++ & (TPOINT_RING_NUM - 1)];
+
+    r->id = id;
+    r->a  = a;
+    r->b  = b;
+
+    tpoint_ring.hits[id]++;
+}
+
+
+/// @name   tpoint_enable( id, enable )
+/// @brief  patch all sites of id with jal to the record path (enable) or
+///         with nop (disable), M-mode code
+/// @return number of patched sites, -1 - invalid id
+int tpoint_enable(unsigned long id, int enable) {
+
+    register const tpoint_site_t *tp;
+    register int                  num = 0;
+
+    if ( id >= TP_NUM ) {
+        ERROR("invalid tracepoint id %ld\n", id);
+        return -1;
+    }
+
+    for (tp = __tpoint_start; tp < __tpoint_end; tp++) {
+        if ( tp->id != id )
+            continue;
+        *(volatile unsigned long *)tp->site = (enable) ? tpoint_jal(tp->site, tp->target) : TPOINT_NOP;
+        num++;
+    }
+
+    asm volatile ("fence.i" ::: "memory");  // patched sites are fetched again
+
+    return num;
+}
+
+
+/// @name   tpoint_lookup( *name )
+/// @brief  tracepoint id by name
+/// @return id, -1 - unknown name
+int tpoint_lookup(const char *name) {
+
+    register int         id;
+    register const char *p, *q;
+
+    for (id = 0; id < TP_NUM; id++) {
+        for (p = tpoint_name[id], q = name; *p && *p == *q; p++, q++)
+            ;
+        if ( *p == *q )
+            return id;
+    }
+
+    return -1;
+}
+
+
+/// @name   tpoint_dump()
+/// @brief  print hit counters and ring, oldest record first
+void tpoint_dump(void) {
+
+    register unsigned long i, first, num = tpoint_ring.num;
+
+    for (i = 0; i < TP_NUM; i++)
+        printf("tpoint: %s hits %lu\n", tpoint_name[i], tpoint_ring.hits[i]);
+
+    first = (num > TPOINT_RING_NUM) ? num - TPOINT_RING_NUM : 0;
+
+    for (i = first; i < num; i++) {
+        tpoint_rec_t *r = &tpoint_ring.rec[i & (TPOINT_RING_NUM - 1)];
+        printf("tpoint: %s 0x%lx 0x%lx\n", tpoint_name[r->id], r->a, r->b);
+    }
+}
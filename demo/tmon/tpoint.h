@@ -0,0 +1,86 @@
+/// @file       tpoint.h
+/// @brief      RISC-V Test Monitor - jump-label style dynamic tracepoints,
+///             M-mode (patching) and any mode (sites) code
+
+
+/*
+    Tracepoint site is a single nop in the instrumented path (asm goto),
+    site address, record path address and tracepoint id are collected in
+    .tpoint section (linker.ld, __tpoint_start..__tpoint_end):
+
+    - disabled site costs one nop, no load or branch
+    - tpoint_enable() patches every site of the id with "jal zero, <record
+      path>" and executes fence.i, tpoint_disable() writes nop back
+    - record path calls tpoint_hit(), which appends (id, a, b) to the
+      shared ring (.data) and counts hits per id, then falls through to the
+      code after the site
+    - tracepoints are controlled by id or by name with TMON_FID_TPOINT
+      from any mode, patching is done by M-mode (.text is not writable in
+      lower modes)
+
+    New tracepoint: add X(TP_xxx, "name") to TPOINT_LIST, put
+    TPOINT(TP_xxx, a, b) to the path.
+*/
+
+#define TPOINT_LIST(X)                      \
+    X(TP_ECALL,     "ecall")    /* M-mode monitor call dispatch (fid, a1)  */ \
+    X(TP_PRIV,      "priv")     /* M-mode privilege switch (next, epc)     */ \
+    X(TP_M_FAULT,   "m_fault")  /* M-mode MPU/PMP fault (cause, tval)      */ \
+    X(TP_S_FAULT,   "s_fault")  /* S-mode SMPU/SPMP fault (cause, tval)    */
+
+#define TPOINT_ID(__id__, __name__)     __id__,
+
+enum { TPOINT_LIST(TPOINT_ID) TP_NUM };
+
+#ifndef TPOINT_RING_NUM
+#define TPOINT_RING_NUM     64      // power of 2
+#endif
+
+#define TPOINT_NOP          0x00000013UL    // addi zero, zero, 0
+
+typedef struct tpoint_site_s {
+    unsigned long   site;           // nop address
+    unsigned long   target;         // record path address
+    unsigned long   id;
+} tpoint_site_t;
+
+typedef struct tpoint_rec_s {
+    unsigned long   id;
+    unsigned long   a;
+    unsigned long   b;
+} tpoint_rec_t;
+
+typedef struct tpoint_ring_s {
+    unsigned long   num;            // records written (ring index)
+    unsigned long   hits[TP_NUM];   // hits per id
+    tpoint_rec_t    rec[TPOINT_RING_NUM];
+} tpoint_ring_t;
+
+extern tpoint_ring_t tpoint_ring;
+
+
+/// @name   tpoint_on( id )
+/// @brief  site of tracepoint id, nop falls through (0), patched jal takes
+///         the record path (1)
+static inline __attribute__((always_inline)) int tpoint_on(const unsigned long id) {
+
+    asm goto (
+        "1:     nop                             \n"
+        "       .pushsection .tpoint, \"a\"     \n"
+        "       .balign 4                       \n"
+        "       .word 1b, %l[on], %0            \n"
+        "       .popsection                     \n"
+        : : "i"(id) : : on );
+
+    return 0;
+on:
+    return 1;
+}
+
+#define TPOINT(__id__, __a__, __b__)    \
+    do { if ( tpoint_on(__id__) ) tpoint_hit((__id__), (unsigned long)(__a__), (unsigned long)(__b__)); } while (0)
+
+extern void tpoint_hit     ( unsigned long id, unsigned long a, unsigned long b );
+extern int  tpoint_enable  ( unsigned long id, int enable );
+extern int  tpoint_lookup  ( const char *name );
+extern void tpoint_dump    ( void );
@@ -0,0 +1,239 @@
+/// @file       twheel.c
+/// @brief      RISC-V Test Monitor - tickless hierarchical timer wheel,
+///             level independent code (M-mode mtmr.c, S-mode stmr.c)
+
+#include "arch/arch.h"
+#include "tmon.h"
+#include "twheel.h"
+
+
+#define TW_UNITS(__ticks__)     ((__ticks__) >> TWHEEL_RES_SHIFT)
+#define TW_TICKS(__units__)     ((__units__) << TWHEEL_RES_SHIFT)
+#define TW_SHIFT(__level__)     ((__level__) * TWHEEL_SLOT_BITS)
+#define TW_SLOT_MASK            (TWHEEL_SLOTS - 1)
+
+#define TW_MAP_SET(__tw__, __l__, __s__)    ((__tw__)->map[__l__][(__s__) >> 5] |=  (1UL << ((__s__) & 31)))
+#define TW_MAP_CLR(__tw__, __l__, __s__)    ((__tw__)->map[__l__][(__s__) >> 5] &= ~(1UL << ((__s__) & 31)))
+#define TW_MAP_TST(__tw__, __l__, __s__)    ((__tw__)->map[__l__][(__s__) >> 5] &   (1UL << ((__s__) & 31)))
+
+
+/// @name   twheel_link( *tw, *t )
+/// @brief  link timer to the lowest level which window holds its expiry,
+///         expired timers are linked to the current wheel time
+static void twheel_link(twheel_t *tw, twheel_timer_t *t) {
+
+    register u64_t         e = TW_UNITS(t->expires);
+    register u64_t         diff;
+    register unsigned long level, slot;
+
+    if ( e < tw->clk )
+        e = tw->clk;
+
+    for (level = 0; level < TWHEEL_LEVELS - 1; level++) {
+        if ( ((e >> TW_SHIFT(level)) - (tw->clk >> TW_SHIFT(level))) < TWHEEL_SLOTS )
+            break;
+    }
+
+    diff = (e >> TW_SHIFT(level)) - (tw->clk >> TW_SHIFT(level));
+
+    if ( diff >= TWHEEL_SLOTS )
+        diff = TWHEEL_SLOTS - 1;        // beyond top level window, cascaded again
+
+    slot = ((tw->clk >> TW_SHIFT(level)) + diff) & TW_SLOT_MASK;
+
+    t->idx   = level * TWHEEL_SLOTS + slot;
+    t->next  = tw->slot[level][slot];
+    t->pprev = &tw->slot[level][slot];
+
+    if ( t->next )
+        t->next->pprev = &t->next;
+
+    tw->slot[level][slot] = t;
+
+    TW_MAP_SET(tw, level, slot);
+}
+
+
+/// @name   twheel_unlink( *tw, *t )
+/// @brief  unlink timer from its slot (or expiring list)
+static void twheel_unlink(twheel_t *tw, twheel_timer_t *t) {
+
+    register unsigned long level = t->idx / TWHEEL_SLOTS;
+    register unsigned long slot  = t->idx % TWHEEL_SLOTS;
+
+    *t->pprev = t->next;
+
+    if ( t->next )
+        t->next->pprev = t->pprev;
+
+    if ( 0 == tw->slot[level][slot] )
+        TW_MAP_CLR(tw, level, slot);
+
+    t->next  = 0;
+    t->pprev = 0;
+}
+
+
+/// @name   twheel_cascade( *tw, level )
+/// @brief  re-link timers of the current slot of level to lower levels
+static void twheel_cascade(twheel_t *tw, unsigned long level) {
+
+    register unsigned long   slot = (tw->clk >> TW_SHIFT(level)) & TW_SLOT_MASK;
+    register twheel_timer_t *t, *next;
+
+    t = tw->slot[level][slot];
+
+    tw->slot[level][slot] = 0;
+    TW_MAP_CLR(tw, level, slot);
+
+    for ( ; t; t = next) {
+        next = t->next;
+        twheel_link(tw, t);
+    }
+}
+
+
+/// @name   twheel_next_unit( *tw )
+/// @brief  nearest wheel time with work: level 0 expiry or cascade of
+///         non-empty higher level slot
+static u64_t twheel_next_unit(twheel_t *tw) {
+
+    register u64_t         best = TWHEEL_NEVER;
+    register u64_t         base;
+    register unsigned long level, k;
+
+    for (k = 0; k < TWHEEL_SLOTS; k++) {
+        if ( TW_MAP_TST(tw, 0, (tw->clk + k) & TW_SLOT_MASK) ) {
+            best = tw->clk + k;
+            break;
+        }
+    }
+
+    for (level = 1; level < TWHEEL_LEVELS; level++) {
+
+        base = tw->clk >> TW_SHIFT(level);
+
+        // current slot is pending only if wheel time is at its boundary
+        k = ( 0 == (tw->clk & ((1ULL << TW_SHIFT(level)) - 1)) ) ? 0 : 1;
+
+        for ( ; k < TWHEEL_SLOTS; k++) {
+            if ( TW_MAP_TST(tw, level, (base + k) & TW_SLOT_MASK) ) {
+                if ( ((base + k) << TW_SHIFT(level)) < best )
+                    best = (base + k) << TW_SHIFT(level);
+                break;
+            }
+        }
+    }
+
+    return best;
+}
+
+
+/// @name   twheel_init( *tw, now )
+/// @brief  empty wheel, wheel time is set to now (ticks)
+void twheel_init(twheel_t *tw, u64_t now) {
+
+    *tw = (twheel_t){ .clk = TW_UNITS(now), };
+}
+
+
+/// @name   twheel_add( *tw, *t )
+/// @brief  link timer by t->expires (ticks), pending timer is re-linked
+int twheel_add(twheel_t *tw, twheel_timer_t *t) {
+
+    if ( t->pprev ) {
+        twheel_unlink(tw, t);
+        tw->count--;
+    }
+
+    twheel_link(tw, t);
+    tw->count++;
+
+    return 0;
+}
+
+
+/// @name   twheel_del( *tw, *t )
+/// @brief  unlink pending timer
+/// @return 0 - OK, -1 - timer is not pending
+int twheel_del(twheel_t *tw, twheel_timer_t *t) {
+
+    if ( 0 == t->pprev )
+        return -1;
+
+    twheel_unlink(tw, t);
+    tw->count--;
+
+    return 0;
+}
+
+
+/// @name   twheel_next( *tw )
+/// @brief  nearest deadline (ticks) to program hardware comparator for,
+///         TWHEEL_NEVER if the wheel is empty
+u64_t twheel_next(twheel_t *tw) {
+
+    register u64_t next = twheel_next_unit(tw);
+
+    return (TWHEEL_NEVER == next) ? TWHEEL_NEVER : TW_TICKS(next);
+}
+
+
+/// @name   twheel_run( *tw, now, *s )
+/// @brief  cascade and expire timers up to now (ticks), empty wheel time is
+///         skipped. Callbacks are called with trap stack frame s
+/// @return nearest deadline (ticks), TWHEEL_NEVER if the wheel is empty
+u64_t twheel_run(twheel_t *tw, u64_t now, void *s) {
+
+    register u64_t           now_units = TW_UNITS(now);
+    register u64_t           next;
+    register unsigned long   level, slot;
+    twheel_timer_t          *list, *t;
+
+    while ( (next = twheel_next_unit(tw)) <= now_units ) {
+
+        tw->clk = next;
+
+        for (level = TWHEEL_LEVELS - 1; level > 0; level--) {
+            if ( 0 == (tw->clk & ((1ULL << TW_SHIFT(level)) - 1)) )
+                twheel_cascade(tw, level);
+        }
+
+        slot = tw->clk & TW_SLOT_MASK;
+
+        if ( 0 == tw->slot[0][slot] )
+            continue;                   // cascade only
+
+        // detach expiring timers, callbacks may del/add any timer
+
+        list = tw->slot[0][slot];
+        list->pprev = &list;
+
+        tw->slot[0][slot] = 0;
+        TW_MAP_CLR(tw, 0, slot);
+
+        tw->clk++;
+
+        while ( (t = list) ) {
+
+            twheel_unlink(tw, t);
+            tw->count--;
+
+            tw->current = t;
+            t->fn(s);
+
+            if ( t->period && (0 == t->pprev) ) {
+                t->expires += t->period;
+                twheel_link(tw, t);
+                tw->count++;
+            }
+        }
+
+        tw->current = 0;
+    }
+
+    if ( tw->clk <= now_units )
+        tw->clk = now_units + 1;        // no work up to now
+
+    return twheel_next(tw);
+}
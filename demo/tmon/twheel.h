@@ -0,0 +1,62 @@
+/// @file       twheel.h
+/// @brief      RISC-V Test Monitor - tickless hierarchical timer wheel,
+///             level independent code (M-mode mtmr.c, S-mode stmr.c)
+
+#pragma once
+
+
+/*
+    Timer wheel of TWHEEL_LEVELS levels x 64 slots, level l slot covers
+    64^l time units (unit = 2^TWHEEL_RES_SHIFT timer ticks):
+
+    - timer is linked to the lowest level which window holds its expiry,
+      level 0 slot holds timers which expire exactly at the slot time
+    - higher level slot is cascaded (re-linked to lower levels) when wheel
+      time crosses its boundary, expiries beyond the top level window are
+      parked in the last top level slot and cascaded again
+    - wheel is tickless: twheel_run() skips empty slots and returns the
+      nearest deadline (expiry or cascade point), so hardware comparator
+      is programmed for one event only
+    - timers are caller-allocated, no allocation, add/del are O(1)
+
+    Callbacks have the trap callback signature (m_trap_callback[]) and are
+    called with the trap stack frame of the timer interrupt, running timer
+    is tw->current (arg). Periodic timers are re-linked after callback.
+*/
+
+#ifndef TWHEEL_LEVELS
+#define TWHEEL_LEVELS       5       // 64^5 = 2^30 units
+#endif
+#ifndef TWHEEL_RES_SHIFT
+#define TWHEEL_RES_SHIFT    0       // unit = 2^TWHEEL_RES_SHIFT ticks
+#endif
+
+#define TWHEEL_SLOT_BITS    6
+#define TWHEEL_SLOTS        (1 << TWHEEL_SLOT_BITS)
+#define TWHEEL_NEVER        (~0ULL)
+
+typedef void (*twheel_fn_t)(void *s);
+
+typedef struct twheel_timer_s {
+    struct twheel_timer_s  *next;
+    struct twheel_timer_s **pprev;  // link to this timer, 0 - not pending
+    u64_t           expires;        // ticks
+    u64_t           period;         // ticks, 0 - one-shot
+    twheel_fn_t     fn;
+    void           *arg;
+    unsigned long   idx;            // level * TWHEEL_SLOTS + slot
+} twheel_timer_t;
+
+typedef struct twheel_s {
+    u64_t           clk;            // wheel time, units (next unit to run)
+    unsigned long   map[TWHEEL_LEVELS][TWHEEL_SLOTS / 32];  // non-empty slots
+    twheel_timer_t *slot[TWHEEL_LEVELS][TWHEEL_SLOTS];
+    twheel_timer_t *current;        // running timer (callback context)
+    unsigned long   count;          // pending timers
+} twheel_t;
+
+extern void  twheel_init( twheel_t *tw, u64_t now );
+extern int   twheel_add ( twheel_t *tw, twheel_timer_t *t );
+extern int   twheel_del ( twheel_t *tw, twheel_timer_t *t );
+extern u64_t twheel_next( twheel_t *tw );
+extern u64_t twheel_run ( twheel_t *tw, u64_t now, void *s );
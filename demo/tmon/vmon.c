@@ -0,0 +1,218 @@
+/// @file   vmon.c
+/// @brief  RISC-V Test Monitor - VS-mode Monitor Services
+
+#include "arch/arch.h"
+#include "tmon.h"
+
+typedef void (*vmon_fid_t)(void *s);
+
+static void vmon_fail  (void *s);
+static void vmon_exit  (void *s);
+static void vmon_priv  (void *s);
+static void vmon_expect(void *s);
+static void vmon_verify(void *s);
+static void vmon_cb    (void *s);
+static void vmon_forward(void *s);
+
+static vmon_fid_t v_fid_vector[] = {
+    vmon_fail,          // FID=0  - TMON_FID_FAIL
+    vmon_exit,          // FID=1  - TMON_FID_EXIT
+    vmon_forward,       // FID=2  - TMON_FID_CSRR
+    vmon_forward,       // FID=3  - TMON_FID_CSRW
+    vmon_forward,       // FID=4  - TMON_FID_CSRS
+    vmon_forward,       // FID=5  - TMON_FID_CSRC
+    vmon_forward,       // FID=6  - TMON_FID_ICSRR
+    vmon_forward,       // FID=7  - TMON_FID_ICSRW
+    vmon_forward,       // FID=8  - TMON_FID_ICSRS
+    vmon_forward,       // FID=9  - TMON_FID_ICSRC
+    vmon_priv,          // FID=10 - TMON_FID_PRIV
+    vmon_expect,        // FID=11 - TMON_FID_EXPECT
+    vmon_verify,        // FID=12 - TMON_FID_VERIFY
+    vmon_forward,       // FID=13 - TMON_FID_MSWI
+    vmon_forward,       // FID=14 - TMON_FID_SSWI
+    vmon_forward,       // FID=15 - TMON_FID_MMSI
+    vmon_forward,       // FID=16 - TMON_FID_SMSI
+    vmon_cb,            // FID=17 - TMON_FID_CB
+    vmon_priv,          // FID=18 - TMON_FID_QPRIV
+    vmon_forward,       // FID=19 - TMON_FID_GMSI
+    vmon_forward,       // FID=20 - TMON_FID_APLIC
+    vmon_forward,       // FID=21 - TMON_FID_BMSI
+    vmon_forward,       // FID=22 - TMON_FID_STATS
+    vmon_forward,       // FID=23 - TMON_FID_TPOINT
+};
+
+
+/// @name  vmon_is_local( trap_id )
+/// @brief check if trap is delegated to VS-mode (medeleg & hedeleg, hideleg), 
+///        so it is served by VS-mode monitor. VS-level interrupts are reported 
+///        as S-level ones in VS-mode (VSSI/VSTI/VSEI -> SSI/STI/SEI) 
+static int vmon_is_local(unsigned long trap_id) {
+
+    if (trap_id < 32)
+        return ((m_exc_deleg & s_exc_deleg) >> trap_id) & 1;
+    if (trap_id < 64)
+        return (s_int_deleg >> (trap_id - 32 + 1)) & 1;
+
+    return (s_int_deleg >> CSR_HIDELEG_VSEI_BIT) & 1;
+}
+
+
+/// @name  void v_exc_ecall( *s )
+/// @brief test monitor VS-mode environment call exception trap entry point
+///        (VU-mode ecalls delegated to VS-mode)
+void v_exc_ecall(void *s ) {
+
+    register unsigned long *sf = (unsigned long *)s;
+    fid_t fid = (fid_t)(sf[4]);
+
+    if ( fid >= sizeof(v_fid_vector) / sizeof(v_fid_vector[0]) ) {
+        ERROR("Unsupported VS-mode ecall FID=%ld\n", sf[4]);
+        TRACE("pc: 0x%lx; status: %lx;\n", sf[17], sf[16] );
+        exit(-1);
+    }
+
+    v_fid_vector[fid](s);
+
+    sf[17] += 4;        // move EPC to the next (after ecall) instruction
+
+    return;
+}
+
+
+/// @name
+/// @brief
+static void vmon_fail(void *s) {
+
+    register unsigned long *sf = (unsigned long *)s;
+
+    ERROR("Fatal error\n");
+    TRACE("pc: 0x%lx; ra: 0x%lx; status: %lx; error: %ld;\n", sf[17], sf[0], sf[16], sf[4] );
+
+    exit(-1);
+}
+
+
+/// @name
+/// @brief
+static void vmon_exit(void *s) {
+
+    register unsigned long *sf = (unsigned long *)s;
+
+    exit(sf[5]);        // exit(a1)
+}
+
+
+/// @name   vmon_priv( *s )
+/// @brief  VS-mode version of privilege switch FID handler. VU/VS targets
+///         update vsstatus.SPP and return with sret, S and M targets are 
+///         passed to VS-mode trap wrapper, which leaves the trap through 
+///         HS/M-mode monitor (vtwr0.S). Non-virtual U target is not reachable 
+///         from VS-level, switch to S-mode first.
+static void vmon_priv(void *s) {
+
+    register unsigned long *sf = (unsigned long *)s;
+
+    unsigned long status  = sf[16];                 // vsstatus
+    unsigned long next    = (unsigned long)(sf[5]); // a1: next privilege & virtualization mode
+
+    switch ( next ) {
+        case 0x04:
+        case 0x05:
+            break;
+        case 0x01:
+        case 0x03:
+            sf[21] = sf[4];                         // request exit to HS/M-mode (PRIV/QPRIV FID)
+            sf[4]  = 0;
+            return;
+        default:
+            ERROR("target privilege mode specification {%ld} is invalid\n", next);
+            exit(-1);
+    }
+
+    // update privilege mode stack in vsstatus value
+    sf[16] = (status & ~CSR_VSSTATUS_SPP_MASK) | ((next & 0x01) << CSR_VSSTATUS_SPP_SHIFT);
+
+    sf[4] = 0;          // OK in a0
+}
+
+
+/// @name   vmon_expect( *s )
+/// @brief  set expectation of specified trap, traps delegated to VS-mode 
+///         are queued locally, others are forwarded to HS-mode
+static void vmon_expect(void *s) {
+
+    register unsigned long *sf      = (unsigned long *)s;
+    register unsigned long trap_id  = sf[5];
+
+    if ( !vmon_is_local(trap_id) ) {
+        return vmon_forward(s);
+    }
+
+    TRACE("expect VS-mode trap #%ld\n", trap_id);
+
+    v_queue_append(trap_id);
+
+    sf[4] = 0;      // OK
+}
+
+
+/// @name   vmon_verify( *s )
+/// @brief  verify that expected VS-mode traps had been raised,
+///         HS/M-mode expectations are verified by HS/M-mode monitors
+static void vmon_verify(void *s) {
+
+    if ( 0 != v_queue_is_empty() ) {
+        ERROR("expected VS-mode trap queue is not empty\n");
+        exit(-1);
+    }
+
+    vmon_forward(s);
+}
+
+
+/// @name   vmon_cb( *s )
+/// @brief  link/unlink user callback to the specified VS-mode trap handler,
+///         callbacks for not delegated traps are forwarded to HS-mode
+/// @return a0 = 0 - OK, -1 - trap beyond callback vector
+static void vmon_cb(void *s) {
+
+    register unsigned long *sf    = (unsigned long *)s;
+    register unsigned long *cb    = (unsigned long *)sf[5];      // in a1
+
+    if ( !vmon_is_local(cb[0]) ) {
+        return vmon_forward(s);
+    }
+
+    if (cb[0] >= 96) {
+        ERROR("VS-mode trap #%ld is beyond callback vector\n", cb[0]);
+        sf[4] = -1;
+        return;
+    }
+
+    if (0 != cb[1]) {
+        TRACE("link user callback @0x%lx to VS-mode trap #%ld\n", cb[1], cb[0]);
+        v_trap_callback[cb[0]] = (void*)cb[1];
+    }
+    else {
+        TRACE("unlink user callback from VS-mode trap #%ld\n", cb[0]);
+        v_trap_callback[cb[0]] = (void*)0;
+    }
+
+    sf[4] = 0;      // OK
+}
+
+
+/// @name   vmon_forward( *s )
+/// @brief  forward request to HS-mode (or M-mode) monitor with VS-mode ecall
+static void vmon_forward(void *s) {
+
+    register unsigned long *sf = (unsigned long *)s;
+
+    register unsigned long a0 asm ("a0") = sf[4];
+    register unsigned long a1 asm ("a1") = sf[5];
+
+    asm volatile ( "ecall \n" : "+r"(a0), "+r"(a1) : : "memory" );
+
+    sf[4] = a0;     // pass HS/M-mode monitor results back to the caller
+    sf[5] = a1;
+}
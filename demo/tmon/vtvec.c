@@ -0,0 +1,580 @@
+/// @file       vtvec.c
+/// @brief      RISC-V Test Monitor - VS-mode Trap API and Vector Tables 
+///             (VS-mode code, S-mode CSRs are accessed as VS-mode ones)
+
+#include "arch/arch.h"
+#include "tmon.h"
+
+/* VS-mode trap wrappers */
+
+extern void _v_trap_wrapper(void);
+extern void _v_vec_table(void);
+
+extern void _v_exc_wrapper(void);
+extern void _v_nvi_wrapper(void);
+
+/* VS-mode ECALL handler (external, see vmon.c) */
+
+extern void v_exc_ecall(void *s);
+
+/* VS-mode default exception trap handlers */
+
+static void v_exc_illegal_inst(void *s);
+static void v_exc_fetch_fault (void *s);     
+static void v_exc_load_fault  (void *s);    
+static void v_exc_cross_fault (void *s);    
+static void v_exc_store_fault (void *s);    
+
+static void v_exc_default(void *s);
+static void v_maj_default(void *s);
+static void v_ext_default(void *s);
+       void v_nvi_default(void *s);
+
+static void v_maj_ext_wrapper(void *s);
+
+/* VS-mode Software Trap Vector Table */
+
+void *v_trap_vector[96] = {
+    /* 0..31 - exception traps */
+    (void*) v_exc_default,          // 0    - Instruction address misaligned
+    (void*) v_exc_default,          // 1    - Instruction access fault
+    (void*) v_exc_illegal_inst,     // 2    Illegal Instruction
+    (void*) v_exc_default,          // 3    - Breakpoint
+    (void*) v_exc_default,          // 4    - Load Address Misaligned
+    (void*) v_exc_default,          // 5    - Load access fault
+    (void*) v_exc_default,          // 6    - Store/AMO address misaligned
+    (void*) v_exc_default,          // 7    - Store/AMO access fault
+
+    (void*) v_exc_ecall,            // 8    VU-mode ecall
+    (void*) v_exc_default,          // 9    - not delegated to VS-mode
+    (void*) v_exc_default,          // 10   - not delegated to VS-mode
+    (void*) v_exc_default,          // 11   - not delegated to VS-mode
+    (void*) v_exc_fetch_fault,      // 12   MMU/MPU/PMP instruction fetch fault
+    (void*) v_exc_load_fault,       // 13   MMU/MPU/PMP load fault
+    (void*) v_exc_cross_fault,      // 14   ---/MPU/--- region crossing fault
+    (void*) v_exc_store_fault,      // 15   MMU/MPU/PMP store/AMO fault
+    
+    (void*) v_exc_default,          // 16   reserved
+    (void*) v_exc_default,          // 17   -- 
+    (void*) v_exc_default,          // 18   
+    (void*) v_exc_default,          // 19
+    (void*) v_exc_default,          // 20
+    (void*) v_exc_default,          // 21
+    (void*) v_exc_default,          // 22
+    (void*) v_exc_default,          // 23   -- 
+
+    (void*) v_exc_default,          // 24   custom
+    (void*) v_exc_default,          // 25   -- 
+    (void*) v_exc_default,          // 26
+    (void*) v_exc_default,          // 27
+    (void*) v_exc_default,          // 28
+    (void*) v_exc_default,          // 29
+    (void*) v_exc_default,          // 30
+    (void*) v_exc_default,          // 31   --
+
+    /* 32..63 - major interrupts */
+    
+    (void*) v_maj_default,          // 32 maj0  unused
+    (void*) v_maj_default,          // 33 maj1  VS-mode software interrupt (VSSI as SSI)
+    (void*) v_maj_default,          // 34 maj2  -
+    (void*) v_maj_default,          // 35 maj3  -
+    (void*) v_maj_default,          // 36 maj4  unused
+    (void*) v_maj_default,          // 37 maj5  VS-mode timer interrupt (VSTI as STI)
+    (void*) v_maj_default,          // 38 maj6  -
+    (void*) v_maj_default,          // 39 maj7  -
+
+    (void*) v_maj_default,          // 40 maj8  unused
+    (void*) v_maj_ext_wrapper,      // 41 maj9  VS-mode external interrupt (VSEI as SEI)
+    (void*) v_maj_default,          // 42 maj10 -
+    (void*) v_maj_default,          // 43 maj11 -
+    (void*) v_maj_default,          // 44 maj12 -
+    (void*) v_maj_default,          // 45 maj13 Counter overflow interrupt
+    (void*) v_maj_default,          // 46
+    (void*) v_maj_default,          // 47
+
+    (void*) v_maj_default,          // 48
+    (void*) v_maj_default,          // 49
+    (void*) v_maj_default,          // 50
+    (void*) v_maj_default,          // 51
+    (void*) v_maj_default,          // 52
+    (void*) v_maj_default,          // 53
+    (void*) v_maj_default,          // 54
+    (void*) v_maj_default,          // 55
+
+    (void*) v_maj_default,          // 56
+    (void*) v_maj_default,          // 57
+    (void*) v_maj_default,          // 58
+    (void*) v_maj_default,          // 59
+    (void*) v_maj_default,          // 60
+    (void*) v_maj_default,          // 61
+    (void*) v_maj_default,          // 62
+    (void*) v_maj_default,          // 63
+    
+    /* 64..95 - external interrupt */
+    
+    (void*) v_ext_default,          // 64
+    (void*) v_ext_default,          // 65
+    (void*) v_ext_default,          // 66
+    (void*) v_ext_default,          // 67
+    (void*) v_ext_default,          // 68
+    (void*) v_ext_default,          // 69
+    (void*) v_ext_default,          // 70
+    (void*) v_ext_default,          // 71
+
+    (void*) v_ext_default,          // 72
+    (void*) v_ext_default,          // 73
+    (void*) v_ext_default,          // 74
+    (void*) v_ext_default,          // 75
+    (void*) v_ext_default,          // 76
+    (void*) v_ext_default,          // 77
+    (void*) v_ext_default,          // 78
+    (void*) v_ext_default,          // 79
+
+    (void*) v_ext_default,          // 80
+    (void*) v_ext_default,          // 81
+    (void*) v_ext_default,          // 82
+    (void*) v_ext_default,          // 83
+    (void*) v_ext_default,          // 84
+    (void*) v_ext_default,          // 85
+    (void*) v_ext_default,          // 86
+    (void*) v_ext_default,          // 87
+
+    (void*) v_ext_default,          // 88
+    (void*) v_ext_default,          // 89
+    (void*) v_ext_default,          // 90
+    (void*) v_ext_default,          // 91
+    (void*) v_ext_default,          // 92
+    (void*) v_ext_default,          // 93
+    (void*) v_ext_default,          // 94
+    (void*) v_ext_default,          // 95
+};
+
+/* VS-mode Trap User Callback Vector */
+
+void *v_trap_callback[96] = {};
+
+
+/******************************************************************************
+** VS-mode default trap handlers 
+******************************************************************************/
+
+
+/// @name   v_exc_default( *s )
+/// @brief  default VS-mode exception trap handler
+static void v_exc_default(void *s) {
+
+    register unsigned long *sf      = (unsigned long *)s;
+    register unsigned long scause   = sf[18];
+
+    if ( scause == v_queue_pop() ) {
+        TRACE("expected VS-mode exception trap #0x%lx\n", scause);
+        if ( 0 != v_trap_callback[scause] ) {
+            ((void (*)(void*))(v_trap_callback[scause]))(s);   
+        }
+        else {
+            WARNING("no user callback assigned to trap #%ld\n", scause);
+        }
+    }
+    else {
+        ERROR("unexpected VS-mode exception trap #%ld @PC=%lu\n", scause, sf[17]);
+        TRACE("vscause: 0x%lx; vsstatus: 0x%lx\n", sf[18], sf[16] );
+        exit(-1);
+    }
+}
+
+
+/// @name   v_maj_default( *s )
+/// @brief  default VS-mode major interrupt trap handler
+static void v_maj_default(void *s) {
+
+    register unsigned long *sf      = (unsigned long *)s;
+    register unsigned long iid      = sf[18] & ~CSR_xCAUSE_INT_MASK;
+    register unsigned long expect   = v_queue_pop();
+
+    if ( (32 + iid) == expect ) {
+        TRACE("expected VS-mode major interrupt trap iid=%ld\n", iid);
+        if ( 0 != v_trap_callback[expect] ) {
+            ((void (*)(void*))(v_trap_callback[expect]))(s);   
+        }
+        else {
+            WARNING("no user callback assigned to trap #%ld\n", expect);
+        }
+    }
+    else {
+        ERROR("unexpected VS-mode major interrupt trap #%ld, expected #%ld\n", iid, expect - 32);
+        TRACE("vscause: 0x%lx; vsstatus: 0x%lx\n", sf[18], sf[16] );
+        exit(-1);
+    }
+}
+
+
+/// @name   v_ext_default( *s )
+/// @brief  default VS-mode external interrupt trap handler
+static void v_ext_default(void *s) {
+
+    register unsigned long *sf      = (unsigned long *)s;
+    register unsigned long eiid     = sf[20] >> 16;
+    register unsigned long expect   = v_queue_pop();
+
+    if ( (64 + eiid) == expect && expect < 96 ) {
+        TRACE("expected VS-mode external interrupt trap eiid=%ld\n", eiid);
+        if ( 0 != v_trap_callback[expect] ) {
+            ((void (*)(void*))(v_trap_callback[expect]))(s);   
+        }
+        else {
+            WARNING("default external interrupt handler with no user callback assigned to #%ld\n", expect);
+        }
+    }
+    else {
+        ERROR("unexpected VS-mode external interrupt trap #%ld, expect %ld\n", eiid, expect - 64);
+        TRACE("vscause: 0x%lx; epc: 0x%lx\n", sf[18], sf[17] );
+        exit(-1);
+    }
+}
+
+
+/// @name  v_nvi_default( *s )
+/// @brief VS-mode nested interrupt handler (vstvec.MODE=3)
+void v_nvi_default(void *s) {
+
+    register unsigned long *sf = (unsigned long *)s;
+    register unsigned long expect = v_queue_pop(); 
+    register unsigned long eiid; 
+
+    __csrw(CSR_SISELECT, S_EI_THRESHOLD_REG);
+    __csrrw(eiid, CSR_SIREG, 0);
+
+    sf[20] = eiid;              // store current eiid to the trap stack frame
+                                // and make it visible to the next level 
+
+    if ( (32 + eiid) == expect ) {
+        TRACE("expected VS-mode external interrupt trap eiid=%ld\n", eiid);
+        if ( 0 != v_trap_callback[expect] ) {
+            ((void (*)(void*s))(v_trap_callback[expect]))(s);   
+        }
+        else {
+            WARNING("default external interrupt handler with no user callback assigned to #%ld\n", expect);
+        }        
+    } 
+    else {
+        ERROR("unexpected VS-mode external interrupt trap #%ld, expect %ld\n", eiid, expect - 32);
+        TRACE("pc: 0x%lx; status: %lx\n", sf[17], sf[16] );
+        exit(-1);
+    }
+}
+
+
+/// @name   v_maj_ext_wrapper( *s )
+/// @brief  default VS-mode major external interrupt handler, vstvec.MODE=0,1
+///         (guest interrupt file selected by hstatus.VGEIN)
+static void v_maj_ext_wrapper(void *s) {
+
+    register unsigned long *sf      = (unsigned long *)s;
+    register unsigned long topei;
+
+    // read top eiid and claim it (vstopei)
+    __csrrw(topei, CSR_STOPEI, 0);
+
+    sf[20] = topei;     // store topei to the trap stack frame, 
+                        // so it is visible at the next level 
+ 
+    if ( (topei >> 16) < 32 )
+        return ((void (*)(void*))(v_trap_vector[64 + (topei >> 16)]))(s);
+
+    return v_ext_default(s);            // no vector beyond EIID 31
+}
+
+/******************************************************************************
+** Named VS-mode exception handlers 
+******************************************************************************/
+
+
+/// @name   void v_exc_illegal_inst( *s )
+/// @brief  test monitor VS-mode illegal instruction trap handler
+static void v_exc_illegal_inst(void *s ) {
+
+    register unsigned long *sf = (unsigned long *)s;
+    register unsigned long tval;
+
+    __csrr(tval, CSR_STVAL);
+
+    if ( 2 == v_queue_pop() ) {
+
+        TRACE("expected illegal instruction trap @0x%lx\n", tval);
+        sf[17] += 4;                        // shift epc, skip faulty instruction
+        return;
+    }
+    else {
+
+        ERROR("unexpected illegal instruction trap @0x%lx\n", tval);
+        exit(-1);
+    } 
+
+}
+
+
+/// @name   v_exc_fetch_fault( *s )
+/// @brief  test monitor VS-mode instruction fetch fault trap handler
+static void v_exc_fetch_fault(void *s ) {
+
+    register unsigned long *sf = (unsigned long *)s;
+    register unsigned long tval;
+
+    __csrr(tval, CSR_STVAL);
+
+    if ( 12 == v_queue_pop() ) {
+
+        TRACE("expected instruction fetch fault @0x%lx\n", tval);
+        sf[17] = sf[0];                     // load ra to epc, skip faulty instruction
+        return;
+    }
+    else {
+
+        ERROR("unexpected instruction fetch fault @0x%lx\n", tval);
+        exit(-1);
+    }
+}
+
+
+/// @name   v_exc_load_fault( *s )
+/// @brief  test monitor VS-mode load fault exception trap handler
+static void v_exc_load_fault (void *s ) {
+
+    register unsigned long *sf = (unsigned long *)s;
+    register unsigned long tval;
+
+    __csrr(tval, CSR_STVAL);
+
+    if ( 13 == v_queue_pop() ) {
+
+        TRACE("expected data load fault @0x%lx\n", tval);
+        sf[17] += 4;                        // shift epc, skip faulty instruction
+        return;
+
+    }
+    else {
+        ERROR("unexpected data load fault @0x%lx\n", tval);
+        exit(-1);
+    }
+}
+
+
+/// @name   v_exc_cross_fault( *s )
+/// @brief  test monitor VS-mode MPU region crossing fault exception trap handler
+static void v_exc_cross_fault(void *s ) {
+
+    register unsigned long *sf = (unsigned long *)s;
+    register unsigned long tval;
+
+    __csrr(tval, CSR_STVAL);
+
+    if ( 14 == v_queue_pop() ) {
+
+        TRACE("expected SMPU region crossing fault @0x%lx\n", tval);
+        sf[17] += 4;                        // shift epc, skip faulty instruction
+        return;
+
+    }
+    else {
+        ERROR("unexpected SMPU region crossing fault @0x%lx\n", tval);
+        exit(-1);
+    }
+
+}
+
+
+/// @name   v_exc_store_fault( *s )
+/// @brief  test monitor VS-mode data store/AMO fault exception trap handler
+static void v_exc_store_fault(void *s ) {
+
+    register unsigned long *sf = (unsigned long *)s;
+    register unsigned long tval;
+
+    __csrr(tval, CSR_STVAL);
+
+    if ( 15 == v_queue_pop() ) {
+
+        TRACE("expected data store fault @0x%lx\n", tval);
+        sf[17] += 4;                        // shift epc, skip faulty instruction
+        return;
+
+    }
+    else {
+
+        ERROR("unexpected data store fault @0x%lx\n", tval);
+        exit(-1);
+
+    }
+}
+
+
+/******************************************************************************
+** VS-mode Trap API 
+******************************************************************************/
+
+
+/// @name   v_trap_mode(mode)
+/// @brief  set VS-mode trap handling mode and vector (vstvec)
+int v_trap_mode(int mode) {
+
+    register unsigned long stvec;
+
+    switch (mode) {
+        case 0:
+            stvec = (unsigned long)(_v_trap_wrapper);
+            break;
+        case 1:
+            stvec = (unsigned long)(_v_vec_table);
+            stvec |= mode;
+            break;
+        case 3:
+            v_trap_vector[32] = (void*)_v_exc_wrapper;
+            for (int i = 33; i < 96; i++)
+                v_trap_vector[i] = (void*)_v_nvi_wrapper;
+            stvec = (unsigned long)(&v_trap_vector[32]);
+            stvec |= mode;
+            break;
+        default:
+            return -1;
+    }
+
+    __csrw(CSR_STVEC, stvec);
+
+    return 0;
+}
+
+
+/// @name   v_exc_setvec(eid, *handler)
+/// @brief  add exception trap handler entry to vector table 
+int v_exc_setvec(int eid, void *handler) {
+
+    v_trap_vector[eid] = handler;
+
+    return 0;
+}
+
+
+/// @name   v_maj_setvec(iid, *handler)
+/// @brief  add major interrupt trap handler entry to vector table
+///         (depends on configured trap handling mode)
+int v_maj_setvec(int iid, void *handler) {
+
+    register unsigned long stvec;
+
+    __csrr(stvec, CSR_STVEC);
+
+    switch (stvec & 0x03) {
+        case 0:
+        case 1:
+            v_trap_vector[32 + iid] = handler;
+            break;
+        case 3:
+            ERROR("not supported for major interrupts in nested vectored mode. use v_ext_setvec() instead\n");
+            exit(-1);
+        default:
+            ERROR("not yet implemented\n");
+            exit(-1);
+    }
+
+    return 0;
+}
+
+
+/// @name   v_ext_setvec(eiid, *handler)
+/// @brief  add external interrupt trap handler entry to vector table
+///         (depends on configured trap handling mode)
+int v_ext_setvec(int eiid, void *handler) {
+
+    register unsigned long stvec;
+
+    if ( eiid < 0 || eiid >= 32 ) {
+        ERROR("VS-mode external interrupt #%d has no trap vector entry\n", eiid);
+        return -1;
+    }
+
+    __csrr(stvec, CSR_STVEC);
+
+    switch (stvec & 0x03) {
+        case 0:
+        case 1:
+            v_trap_vector[32 + 32 + eiid] = handler;
+            break;
+        case 3:
+        // not yet supported
+        default:
+            WARNING("not yet implemented\n");
+            return -1;
+    }
+
+    return 0;
+}
+
+
+/// @name   v_maj_enable(iid, enable)
+/// @brief  enable/disable VS-mode major interrupt (vsie)
+int v_maj_enable(int iid, int enable) {
+
+    if (enable)
+        __csrs(CSR_SIE, 1 << iid);
+    else
+        __csrc(CSR_SIE, 1 << iid);
+
+    return 0;
+}
+
+
+/// @name   v_ext_enable(eiid, enable)
+/// @brief  Enable/disable guest IMSIC interrupt by EIID 
+int v_ext_enable(int eiid, int enable) {
+
+    register unsigned long ireg = S_EI_ENABLE_REG(eiid >> 5);
+    register unsigned long ival = 1 << (eiid % 32);
+
+    __csrw(CSR_SISELECT, ireg);
+
+    if (enable)
+        __csrs(CSR_SIREG, ival);
+    else    
+        __csrc(CSR_SIREG, ival);
+
+    return 0;
+}
+
+
+/// @name   v_ext_delivery(enable)
+/// @brief  Enable/disable guest IMSIC MSI delivery
+int v_ext_delivery(int enable) {
+
+    __csrw(CSR_SISELECT, S_EI_DELIVERY_REG);
+
+    if (enable)
+        __csrw(CSR_SIREG, 1);
+    else    
+        __csrw(CSR_SIREG, 0);
+
+    return 0;
+}
+
+
+/// @name   v_ext_threshold(threshold)
+/// @brief  Set guest IMSIC priority threshold level
+int v_ext_threshold(int threshold) {
+
+    __csrw(CSR_SISELECT, S_EI_THRESHOLD_REG);
+    __csrw(CSR_SIREG, (unsigned long)threshold);
+
+    return 0;    
+}
+
+
+/// @name   v_all_enable( enable )
+/// @brief  Enable/disable VS-mode interrupts (vsstatus.SIE)
+int v_all_enable(int enable) {
+
+    if (enable) 
+        __csrs(CSR_SSTATUS, (1 << 1));
+    else    
+        __csrc(CSR_SSTATUS, (1 << 1));
+
+    return enable;
+}
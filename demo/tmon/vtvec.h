@@ -0,0 +1,26 @@
+/// @file       vtvec.h
+/// @brief      RISC-V Test Monitor - VS-mode Trap API and Vector Tables 
+
+
+/* Predefined VS-mode Trap Wrappers */
+
+extern void _v_trap_wrapper(void );        // direct mode exc/maj trap wrapper (vtwr0.S)
+extern void _v_vec_table(void );           // vectored mode HW vector table (vtwr1.S)
+
+/* Predefined Software Trap Vector Table */
+
+extern void* v_trap_vector[];
+
+/* VS-mode Trap API (called in VS-mode) */
+
+extern int v_trap_mode(int mode);
+extern int v_exc_setvec(int eid, void *handler);
+extern int v_maj_setvec(int iid, void *handler);
+extern int v_ext_setvec(int eiid, void *handler);
+extern int v_maj_enable(int iid, int enable);
+extern int v_ext_enable(int eiid, int enable);
+
+extern int v_ext_delivery(int enable);
+extern int v_ext_threshold(int threshold);
+
+extern int v_all_enable(int enable);
@@ -0,0 +1,240 @@
+/// @file       work.c
+/// @brief      RISC-V Test Monitor - deferred work queue (bottom-halves),
+///             M-mode and S-mode code
+
+#include "arch/arch.h"
+#include "tmon.h"
+#include "mtvec.h"
+#include "stvec.h"
+#include "work.h"
+
+
+/* M-mode and S-mode queues */
+
+work_queue_t m_work = { .level = WORK_LEVEL_M, .lat_min = ~0UL, };
+work_queue_t s_work = { .level = WORK_LEVEL_S, .lat_min = ~0UL, };
+
+
+/// @name   work_cycle( *wq )
+/// @brief  cycle counter of the queue level
+static inline unsigned long work_cycle(work_queue_t *wq) {
+
+    register unsigned long cycle;
+
+    if ( WORK_LEVEL_M == wq->level )
+        __csrr(cycle, CSR_MCYCLE);
+    else
+        __csrr(cycle, CSR_CYCLE);
+
+    return cycle;
+}
+
+
+/// @name   work_irq( *wq, enable )
+/// @brief  enable/disable interrupts of the queue level (mstatus.MIE or
+///         sstatus.SIE)
+/// @return previous state, 0 - disabled
+static inline unsigned long work_irq(work_queue_t *wq, unsigned long enable) {
+
+    register unsigned long status;
+
+    if ( WORK_LEVEL_M == wq->level ) {
+        __csrr(status, CSR_MSTATUS);
+        status &= BIT(CSR_MSTATUS_MIE_BIT);
+        m_all_enable(enable);
+    } else {
+        __csrr(status, CSR_SSTATUS);
+        status &= BIT(CSR_xSTATUS_SIE_BIT);
+        s_all_enable(enable);
+    }
+
+    return status;
+}
+
+
+/// @name   work_trap_unmasked( *wq, *s )
+/// @brief  check interrupts of the queue level were enabled in the context
+///         interrupted by trap s (lower privilege, or xPIE of the frame)
+static inline int work_trap_unmasked(work_queue_t *wq, void *s) {
+
+    register unsigned long *sf = (unsigned long *)s;
+
+    if ( WORK_LEVEL_M == wq->level )
+        return (CSR_MSTATUS_MPP_MASK != (sf[16] & CSR_MSTATUS_MPP_MASK)) ||
+               (sf[16] & BIT(CSR_MSTATUS_MPIE_BIT));
+
+    return !(sf[16] & BIT(CSR_xSTATUS_SPP_BIT)) || (sf[16] & BIT(CSR_xSTATUS_SPIE_BIT));
+}
+
+
+/// @name   m_work_swi( *s )
+/// @brief  M-mode software interrupt handler, runs M-mode bottom-halves
+static void m_work_swi(void *s) {
+
+    __mmio_base[0] = 0;                 // de-assert MSWI, items queued by bottom-halves re-assert it
+
+    work_run(&m_work, s);
+}
+
+
+/// @name   s_work_swi( *s )
+/// @brief  S-mode software interrupt handler, runs S-mode bottom-halves
+static void s_work_swi(void *s) {
+
+    tmon_call(TMON_FID_SSWI, 0);        // de-assert SSWI, MMIO may not be mapped in S-mode
+
+    work_run(&s_work, s);
+}
+
+
+/// @name   m_work_init( trigger )
+/// @brief  reset M-mode queue and set bottom-half trigger (enum work_trigger),
+///         software interrupt trigger needs mtvec.MODE=0
+int m_work_init(int trigger) {
+
+    register unsigned long mtvec;
+
+    if ( WORK_TRIGGER_SWI == trigger ) {
+
+        __csrr(mtvec, CSR_MTVEC);
+
+        if ( mtvec & 0x03 ) {
+            WARNING("MSWI work trigger is not supported for mtvec.MODE=%ld\n", mtvec & 0x03);
+            return -1;
+        }
+
+        m_maj_setvec(TRAP_IID_MSWI, m_work_swi);
+        m_maj_enable(TRAP_IID_MSWI, 1);
+    }
+
+    m_work = (work_queue_t){ .trigger = trigger, .level = WORK_LEVEL_M, .lat_min = ~0UL, };
+
+    return 0;
+}
+
+
+/// @name   s_work_init( trigger )
+/// @brief  reset S-mode queue and set bottom-half trigger (enum work_trigger),
+///         software interrupt trigger needs stvec.MODE=0
+int s_work_init(int trigger) {
+
+    register unsigned long stvec;
+
+    if ( WORK_TRIGGER_SWI == trigger ) {
+
+        __csrr(stvec, CSR_STVEC);
+
+        if ( stvec & 0x03 ) {
+            WARNING("SSWI work trigger is not supported for stvec.MODE=%ld\n", stvec & 0x03);
+            return -1;
+        }
+
+        s_maj_setvec(TRAP_IID_SSWI, s_work_swi);
+        s_maj_enable(TRAP_IID_SSWI, 1);
+    }
+
+    s_work = (work_queue_t){ .trigger = trigger, .level = WORK_LEVEL_S, .lat_min = ~0UL, };
+
+    return 0;
+}
+
+
+/// @name   work_queue( *wq, fn, arg )
+/// @brief  queue bottom-half fn(arg), called by top-half (trap callback or
+///         handler), software interrupt is raised for WORK_TRIGGER_SWI queue
+///         (S-mode queue raises SSWI by TMON_FID_SSWI request, so it is
+///         called from S-mode)
+/// @return 0 - OK, -1 - queue is full, item is dropped
+/// @note   interrupts of the queue level are masked while the item is
+///         queued, bottom-halves run unmasked may be preempted by top-halves
+int work_queue(work_queue_t *wq, work_fn_t fn, unsigned long arg) {
+
+    register unsigned long head, irq;
+    register work_item_t  *item;
+
+    irq  = work_irq(wq, 0);
+    head = wq->head;
+
+    if ((head - wq->tail) >= WORK_QUEUE_SIZE) {
+        wq->drops++;
+        if (irq) work_irq(wq, 1);
+        return -1;
+    }
+
+    item        = &wq->item[head & (WORK_QUEUE_SIZE - 1)];
+    item->fn    = fn;
+    item->arg   = arg;
+    item->stamp = work_cycle(wq);
+
+    wq->head = head + 1;
+
+    if (irq) work_irq(wq, 1);
+
+    if ( WORK_TRIGGER_SWI == wq->trigger ) {
+        if ( WORK_LEVEL_M == wq->level ) {
+            __mmio_base[0] = 1;
+        } else {
+            tmon_call(TMON_FID_SSWI, 1);
+        }
+    }
+
+    return 0;
+}
+
+
+/// @name   work_run( *wq, *s )
+/// @brief  run pending bottom-halves, items queued by bottom-halves are run
+///         by the same call. Called by the trigger in trap context s: every
+///         bottom-half runs with interrupts of the queue level enabled if
+///         the interrupted context had them enabled (always for SWI
+///         trigger), so other sources preempt it. Trap wrappers save
+///         xepc/xstatus/xcause to the frame before dispatch, so a nested
+///         trap returns here and the outer trap return restores them.
+///         Queue is checked and statistics are updated with interrupts
+///         masked. s = 0 - called out of trap context, interrupt state of
+///         the caller is kept
+void work_run(work_queue_t *wq, void *s) {
+
+    register unsigned long tail, lat;
+    register work_item_t  *item;
+    register int           unmask = (s) ? work_trap_unmasked(wq, s) : 0;
+
+    if ( wq->busy || (wq->tail == wq->head) ) {
+        return;                         // nested trigger, outer run is in progress
+    }
+
+    wq->busy = 1;
+
+    for (tail = wq->tail; tail != wq->head; tail++) {
+
+        item = &wq->item[tail & (WORK_QUEUE_SIZE - 1)];
+
+        lat = work_cycle(wq) - item->stamp;
+
+        wq->lat_last = lat;
+        wq->lat_sum += lat;
+        if (lat < wq->lat_min) wq->lat_min = lat;
+        if (lat > wq->lat_max) wq->lat_max = lat;
+
+        if (unmask) work_irq(wq, 1);
+
+        item->fn(item->arg);
+
+        if (unmask) work_irq(wq, 0);
+
+        wq->done++;
+        wq->tail = tail + 1;
+    }
+
+    wq->busy = 0;
+}
+
+
+/// @name   work_report( *wq )
+/// @brief  print queue statistics
+void work_report(work_queue_t *wq) {
+
+    printf("  %s work: %ld done, %ld drops, latency %ld/%ld/%ld cycles (min/avg/max)\n",
+        (WORK_LEVEL_M == wq->level) ? "M-mode" : "S-mode", wq->done, wq->drops,
+        (wq->done) ? wq->lat_min : 0, wq->lat_sum / ((wq->done) ? wq->done : 1), wq->lat_max);
+}
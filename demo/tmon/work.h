@@ -0,0 +1,68 @@
+/// @file       work.h
+/// @brief      RISC-V Test Monitor - deferred work queue (bottom-halves),
+///             M-mode and S-mode code
+
+
+/*
+    Trap callbacks and handlers run with interrupts masked, slow processing
+    is split into top-half and bottom-half:
+
+    - top-half (trap callback) does minimal work and queues bottom-half
+      item with work_queue(), no allocation, full queue drops the item
+    - bottom-halves run later, triggered by MSWI/SSWI self-interrupt or
+      at monitor exit point (after ecall request is served by
+      m/s_exc_ecall()), with interrupts of the queue level enabled
+      (always for SWI trigger, for exit trigger if the ecall caller had
+      them enabled), so other sources preempt long bottom-halves; trap
+      wrappers save xepc/xstatus/xcause to the frame before dispatch, so
+      nested traps return to the bottom-half
+    - S-mode queue raises SSWI with TMON_FID_SSWI request (no direct MMIO
+      access is needed in S-mode)
+    - queue-to-run latency of every item is recorded in cycles
+      (mcycle for M-mode queue, cycle for S-mode queue)
+*/
+
+#ifndef WORK_QUEUE_SIZE
+#define WORK_QUEUE_SIZE     16      // number of queue entries, must be power of 2
+#endif
+
+#define WORK_LEVEL_M        3       // M-mode queue (mcycle, mstatus.MIE, MSWI)
+#define WORK_LEVEL_S        1       // S-mode queue (cycle, sstatus.SIE, SSWI)
+
+enum work_trigger {
+    WORK_TRIGGER_NONE   = 0,        // bottom-halves are run by work_run() only
+    WORK_TRIGGER_SWI    = 1,        // M/S-mode software self-interrupt
+    WORK_TRIGGER_EXIT   = 2,        // monitor exit point (ecall return)
+};
+
+typedef void (*work_fn_t)(unsigned long arg);
+
+typedef struct work_item_s {
+    work_fn_t     fn;
+    unsigned long arg;
+    unsigned long stamp;            // cycle counter at queueing
+} work_item_t;
+
+typedef struct work_queue_s {
+    volatile unsigned long head;    // next free entry, written by top-half only
+    volatile unsigned long tail;    // next pending entry, written by work_run() only
+    unsigned long trigger;          // enum work_trigger
+    unsigned long busy;             // bottom-halves are running (re-entry guard)
+    unsigned long level;            // WORK_LEVEL_M, WORK_LEVEL_S
+    unsigned long drops;            // items dropped on full queue
+    unsigned long done;             // items run
+    unsigned long lat_last;         // queue-to-run latency, cycles
+    unsigned long lat_min;
+    unsigned long lat_max;
+    unsigned long lat_sum;
+    work_item_t   item[WORK_QUEUE_SIZE];
+} work_queue_t;
+
+extern work_queue_t m_work;         // M-mode queue (MSWI)
+extern work_queue_t s_work;         // S-mode queue (SSWI)
+
+extern int  m_work_init( int trigger );
+extern int  s_work_init( int trigger );
+extern int  work_queue ( work_queue_t *wq, work_fn_t fn, unsigned long arg );
+extern void work_run   ( work_queue_t *wq, void *s );
+extern void work_report( work_queue_t *wq );
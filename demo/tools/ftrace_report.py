@@ -0,0 +1,103 @@
+#!/usr/bin/env python3
+### @file   ftrace_report.py
+### @brief  RISC-V Test Monitor - per-function inclusive/exclusive cycles and
+###         trace viewer JSON of function trace (ftrace_flush() output)
+###
+### usage:  ftrace_report.py [-j json-file] <elf-file> [log-file]
+###
+###         log is read from stdin if not given, "ftrace: <e|x> <fn> <delta>"
+###         lines are used and anything else is skipped (symbols: symtab.py)
+###
+###         -j  write Trace Event Format JSON (chrome://tracing, Perfetto),
+###             timestamps are cycles
+###
+###         Records lost by ring wrap-around leave unmatched exits (ignored)
+###         and functions still running at flush (closed at the last record).
+
+import json
+import re
+import sys
+
+from symtab import Symtab
+
+
+RECORD = re.compile(r'ftrace:\s+([ex])\s+0x([0-9a-fA-F]+)\s+(\d+)')
+
+
+def main(argv):
+
+    args = argv[1:]
+    jout = None
+
+    if len(args) >= 2 and args[0] == '-j':
+        jout = args[1]
+        args = args[2:]
+
+    if len(args) < 1:
+        sys.stderr.write('usage: %s [-j json-file] <elf-file> [log-file]\n' % argv[0])
+        return 1
+
+    syms   = Symtab(args[0])
+    log    = open(args[1]) if len(args) > 1 else sys.stdin
+
+    stats  = {}             # name: [calls, inclusive, exclusive]
+    stack  = []             # [addr, name, start, children]
+    events = []
+    now    = 0
+
+    def leave(now):
+        addr, name, start, child = stack.pop()
+        incl = now - start
+        s = stats.setdefault(name, [0, 0, 0])
+        s[0] += 1
+        s[1] += incl
+        s[2] += incl - child
+        if stack:
+            stack[-1][3] += incl
+        events.append({ 'name': name, 'ph': 'E', 'ts': now, 'pid': 0, 'tid': 0 })
+
+    for line in log:
+        m = RECORD.search(line)
+        if not m:
+            continue
+
+        addr = int(m.group(2), 16)
+        now += int(m.group(3))
+
+        if m.group(1) == 'e':
+            name = syms.lookup(addr)
+            stack.append([addr, name, now, 0])
+            events.append({ 'name': name, 'ph': 'B', 'ts': now, 'pid': 0, 'tid': 0 })
+            continue
+
+        if not any(f[0] == addr for f in stack):
+            continue        # entry lost by wrap-around
+
+        while stack[-1][0] != addr:
+            leave(now)      # exits lost (longjmp-like flow), close inner frames
+        leave(now)
+
+    while stack:
+        leave(now)
+
+    if not stats:
+        sys.stderr.write('no records\n')
+        return 1
+
+    print('%8s %12s %12s %7s  %s' % ('calls', 'inclusive', 'exclusive', '%excl', 'function'))
+
+    total = sum(s[2] for s in stats.values()) or 1
+
+    for name, (calls, incl, excl) in sorted(stats.items(), key=lambda kv: -kv[1][2]):
+        print('%8d %12d %12d %6.2f%%  %s' % (calls, incl, excl, 100.0 * excl / total, name))
+
+    if jout:
+        with open(jout, 'w') as f:
+            json.dump({ 'traceEvents': events, 'displayTimeUnit': 'ns',
+                        'otherData': { 'timestamps': 'cycles' } }, f)
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
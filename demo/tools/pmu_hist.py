@@ -0,0 +1,55 @@
+#!/usr/bin/env python3
+### @file   pmu_hist.py
+### @brief  RISC-V Test Monitor - per-function histogram of PMU overflow
+###         samples (pmu_dump() output) with ELF symbols
+###
+### usage:  pmu_hist.py <elf-file> [log-file]
+###
+###         log is read from stdin if not given, "pmu: <epc> <counter>" lines
+###         are used and anything else is skipped (symbols: symtab.py)
+
+import re
+import sys
+
+from symtab import Symtab
+
+
+SAMPLE = re.compile(r'pmu:\s+0x([0-9a-fA-F]+)\s+(\d+)')
+
+
+def main(argv):
+
+    if len(argv) < 2:
+        sys.stderr.write('usage: %s <elf-file> [log-file]\n' % argv[0])
+        return 1
+
+    syms  = Symtab(argv[1])
+    log   = open(argv[2]) if len(argv) > 2 else sys.stdin
+
+    hist  = {}
+    total = 0
+
+    for line in log:
+        m = SAMPLE.search(line)
+        if not m:
+            continue
+        key = (syms.lookup(int(m.group(1), 16)), int(m.group(2)))
+        hist[key] = hist.get(key, 0) + 1
+        total += 1
+
+    if 0 == total:
+        sys.stderr.write('no samples\n')
+        return 1
+
+    print('%8s %7s %4s  %s' % ('samples', '%', 'ctr', 'function'))
+
+    for (name, ctr), num in sorted(hist.items(), key=lambda kv: -kv[1]):
+        print('%8d %6.2f%% %4d  %s' % (num, 100.0 * num / total, ctr, name))
+
+    print('%8d total' % total)
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
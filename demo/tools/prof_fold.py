@@ -0,0 +1,79 @@
+#!/usr/bin/env python3
+### @file   prof_fold.py
+### @brief  RISC-V Test Monitor - flat profile and collapsed stacks of timer
+###         PC samples (prof_flush() output) with ELF symbols
+###
+### usage:  prof_fold.py [-c] <elf-file> [log-file]
+###
+###         log is read from stdin if not given, "prof: <priv> <epc> <ra>"
+###         lines are used and anything else is skipped (symbols: symtab.py)
+###
+###         -c  print collapsed stacks ("mode;caller;function count", input
+###             of flamegraph.pl) instead of flat profile. Caller is the
+###             function of ra, it is omitted if ra is inside the sampled
+###             function (ra of non-leaf function is not the caller)
+
+import re
+import sys
+
+from symtab import Symtab
+
+
+SAMPLE = re.compile(r'prof:\s+(\d+)\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)')
+MODES  = { 0: 'U', 1: 'S', 3: 'M', 4: 'VU', 5: 'VS' }
+
+
+def main(argv):
+
+    collapsed = '-c' in argv[1:]
+    args      = [a for a in argv[1:] if a != '-c']
+
+    if len(args) < 1:
+        sys.stderr.write('usage: %s [-c] <elf-file> [log-file]\n' % argv[0])
+        return 1
+
+    syms  = Symtab(args[0])
+    log   = open(args[1]) if len(args) > 1 else sys.stdin
+
+    flat  = {}
+    stack = {}
+    total = 0
+
+    for line in log:
+        m = SAMPLE.search(line)
+        if not m:
+            continue
+
+        mode   = MODES.get(int(m.group(1)), m.group(1))
+        func   = syms.lookup(int(m.group(2), 16))
+        caller = syms.lookup(int(m.group(3), 16))
+
+        key = (func, mode)
+        flat[key] = flat.get(key, 0) + 1
+
+        key = (mode, func) if caller == func else (mode, caller, func)
+        stack[key] = stack.get(key, 0) + 1
+
+        total += 1
+
+    if 0 == total:
+        sys.stderr.write('no samples\n')
+        return 1
+
+    if collapsed:
+        for key, num in sorted(stack.items()):
+            print('%s %d' % (';'.join(key), num))
+        return 0
+
+    print('%8s %7s %4s  %s' % ('samples', '%', 'mode', 'function'))
+
+    for (func, mode), num in sorted(flat.items(), key=lambda kv: -kv[1]):
+        print('%8d %6.2f%% %4s  %s' % (num, 100.0 * num / total, mode, func))
+
+    print('%8d total' % total)
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
@@ -0,0 +1,37 @@
+### @file   symtab.py
+### @brief  RISC-V Test Monitor - ELF text symbols lookup for host scripts,
+###         symbols are read with $NM (default
+###         $GNU_PATH/bin/riscv32-unknown-elf-nm)
+
+import bisect
+import os
+import subprocess
+
+
+GNU_PATH = os.environ.get('GNU_PATH', '/opt/riscv-gnu-toolchain')
+NM       = os.environ.get('NM', GNU_PATH + '/bin/riscv32-unknown-elf-nm')
+
+
+class Symtab:
+    """sorted text symbols of ELF file, address to function name"""
+
+    def __init__(self, elf):
+
+        out = subprocess.run([NM, '-n', '--defined-only', elf],
+                             check=True, capture_output=True, text=True).stdout
+
+        self.syms = []
+
+        for line in out.splitlines():
+            fields = line.split()
+            if len(fields) == 3 and fields[1] in 'tTwW':
+                self.syms.append((int(fields[0], 16), fields[2]))
+
+        self.addrs = [a for a, _ in self.syms]
+
+    def lookup(self, pc):
+        """name of the function holding pc"""
+
+        i = bisect.bisect_right(self.addrs, pc) - 1
+
+        return self.syms[i][1] if i >= 0 else '??'